@@ -0,0 +1,112 @@
+// 模糊引擎：在完整滑块范围（0~20）上比较 cv::GaussianBlur 与 Box / Recursive 近似，
+// 报告耗时与相对cv::GaussianBlur的误差（最大/平均绝对误差，单位为灰度级）
+// 用法: bench_blur [图像路径...] [--iterations n] [--size WxH]
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "image_utils.h"
+#include "pipeline.h"
+
+namespace {
+
+template <typename Fn>
+double medianSeconds(int iterations, Fn fn) {
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void run(const std::string& name, const cv::Mat& image, int iterations) {
+    const double megapixels = image.total() / 1e6;
+    std::cout << name << " (" << image.cols << "x" << image.rows << "x" << image.channels() << ")\n"
+              << "  blur   exact ms    box ms  (speedup, max/mean err)   recursive ms  (speedup, max/mean err)" << std::endl;
+
+    cv::Mat reference;
+    cv::Mat work;
+    for (int blur = 0; blur <= 20; ++blur) {
+        double exactSeconds = medianSeconds(iterations, [&]() {
+            image.copyTo(reference);
+            applyBlurStage(reference, reference, blur);
+        });
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %4d %9.2f", blur, exactSeconds * 1e3);
+        std::string text = line;
+        for (BlurMethod method : {BlurMethod::Box, BlurMethod::Recursive}) {
+            double seconds = medianSeconds(iterations, [&]() {
+                image.copyTo(work);
+                applyBlurStage(work, work, blur, 1.0, method);
+            });
+            cv::Mat diff;
+            cv::absdiff(reference, work, diff);
+            double maxError = 0;
+            cv::minMaxLoc(diff.reshape(1), nullptr, &maxError);
+            cv::Scalar channelMeans = cv::mean(diff);
+            double meanError = 0;
+            for (int c = 0; c < image.channels(); ++c) {
+                meanError += channelMeans[c] / image.channels();
+            }
+            std::snprintf(line, sizeof(line), "   %9.2f  (%5.2fx, %3.0f / %5.3f)", seconds * 1e3,
+                          exactSeconds / seconds, maxError, meanError);
+            text += line;
+        }
+        std::cout << text << std::endl;
+    }
+    std::cout << "  (" << megapixels << " MP per call, median of " << iterations << " runs)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = 10;
+    cv::Size syntheticSize(3840, 2160);
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            int width = 0;
+            int height = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cerr << "无效的尺寸: " << argv[i] << std::endl;
+                return 2;
+            }
+            syntheticSize = cv::Size(width, height);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        const std::string dir = IMAGE_RESOURCE_DIR;
+        paths = {dir + "/lena.png", dir + "/lena-512-gray.ppm"};
+    }
+
+    for (const auto& path : paths) {
+        cv::Mat image = readImage(path);
+        if (image.empty()) {
+            std::cerr << "无法读取图像: " << path << std::endl;
+            continue;
+        }
+        run(path, image, iterations);
+    }
+
+    // 大图上才能看出核大小对精确路径的影响：把lena平铺到目标尺寸
+    cv::Mat tile = readImage(std::string(IMAGE_RESOURCE_DIR) + "/lena.png");
+    if (!tile.empty()) {
+        cv::Mat large;
+        cv::repeat(tile, syntheticSize.height / tile.rows + 1, syntheticSize.width / tile.cols + 1, large);
+        run("tiled lena", large(cv::Rect(0, 0, syntheticSize.width, syntheticSize.height)).clone(), std::max(1, iterations / 2));
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+// 灰度图像单通道处理 vs 展开为BGR：读取、处理链与写出的耗时和内存
+// 用法: bench_gray [图像路径...] [--iterations n]
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "image_utils.h"
+#include "pipeline.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+template <typename Fn>
+double medianMillis(int iterations, Fn fn) {
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+struct Timings {
+    double readMs = 0;
+    double pipelineMs = 0;
+    double writeMs = 0;
+    size_t imageBytes = 0;
+    cv::Mat output;
+};
+
+Timings measure(const std::function<cv::Mat()>& read, const PipelineParams& params, const std::string& outPath, int iterations) {
+    Timings t;
+    cv::Mat image;
+    t.readMs = medianMillis(iterations, [&]() { image = read(); });
+    t.pipelineMs = medianMillis(iterations, [&]() { t.output = applyPipeline(image, params); });
+    t.writeMs = medianMillis(iterations, [&]() { writeImage(outPath, t.output); });
+    t.imageBytes = image.total() * image.elemSize();
+    return t;
+}
+
+void report(const char* label, const Timings& t, const Timings* baseline) {
+    double total = t.readMs + t.pipelineMs + t.writeMs;
+    std::cout << "  " << label << ": read " << t.readMs << " ms, pipeline " << t.pipelineMs << " ms, write " << t.writeMs
+              << " ms, " << t.imageBytes / 1024 << " KB";
+    if (baseline) {
+        double baseTotal = baseline->readMs + baseline->pipelineMs + baseline->writeMs;
+        std::cout << " (" << baseTotal / std::max(1e-6, total) << "x faster, "
+                  << static_cast<double>(baseline->imageBytes) / std::max<size_t>(1, t.imageBytes) << "x less memory)";
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = 20;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        const std::string dir = IMAGE_RESOURCE_DIR;
+        paths = {dir + "/lena-512-gray.ppm", dir + "/lena-128-gray.ppm"};
+    }
+
+    // 界面上常用的组合：模糊、对比度与锐化都按通道计算
+    PipelineParams params;
+    parsePipelineSpec("blur=5,contrast=20,sharpen=5", params);
+    const fs::path tempDir = fs::temp_directory_path();
+    std::cout << "Pipeline: " << formatPipelineSpec(params) << ", iterations: " << iterations << std::endl;
+
+    for (const auto& path : paths) {
+        cv::Mat probe = readImage(path);
+        if (probe.empty()) {
+            std::cerr << "无法读取图像: " << path << std::endl;
+            continue;
+        }
+        std::cout << path << " (" << probe.cols << "x" << probe.rows << "x" << probe.channels() << ")" << std::endl;
+        if (probe.channels() != 1) {
+            std::cout << "  not a grayscale image, skipped" << std::endl;
+            continue;
+        }
+
+        // 旧路径：readPPM总是展开为BGR，writePPM写出P6
+        Timings bgr = measure([&]() { return readPPM(path); }, params, (tempDir / "bench-gray-bgr.ppm").string(), iterations);
+        Timings gray = measure([&]() { return readImage(path); }, params, (tempDir / "bench-gray.pgm").string(), iterations);
+        report("BGR (P6)", bgr, nullptr);
+        report("1 channel (P5)", gray, &bgr);
+
+        // 逐通道运算对三个相同的通道结果相同，两条路径的输出应当一致
+        cv::Mat expanded;
+        cv::cvtColor(bgr.output, expanded, cv::COLOR_BGR2GRAY);
+        std::cout << "  max abs diff: " << cv::norm(expanded, gray.output, cv::NORM_INF)
+                  << ", file size " << fs::file_size(tempDir / "bench-gray-bgr.ppm") / 1024 << " KB -> "
+                  << fs::file_size(tempDir / "bench-gray.pgm") / 1024 << " KB" << std::endl;
+    }
+    fs::remove(tempDir / "bench-gray-bgr.ppm");
+    fs::remove(tempDir / "bench-gray.pgm");
+    return 0;
+}
@@ -0,0 +1,451 @@
+// 基准测试套件：覆盖图像读写、各处理阶段（按滑块取值）与完整处理链
+// 用法: bench [--filter <子串>] [--sizes 4k,8k,16k] [--threads 1,2,4] [--iterations n] [--json <文件>]
+// 每个用例报告 ns/像素、吞吐量、每次调用的分配次数/字节数，以及相对单线程的加速比。
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "decode_cache.h"
+#include "image_pyramid.h"
+#include "image_utils.h"
+#include "jpeg_search.h"
+#include "pipeline.h"
+#include "staged_pipeline.h"
+#include "tiled_pipeline.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 分配计数：operator new覆盖STL容器等C++分配，MatAllocator覆盖cv::Mat的像素缓冲区
+std::atomic<size_t> gAllocations{0};
+std::atomic<size_t> gAllocatedBytes{0};
+
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base_(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        // 像素缓冲区经fastMalloc分配，不经过operator new；次数已由new UMatData计入，这里只补字节数
+        if (!data) {
+            size_t bytes = CV_ELEM_SIZE(type);
+            for (int i = 0; i < dims; ++i) {
+                bytes *= static_cast<size_t>(sizes[i]);
+            }
+            gAllocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        return base_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        return base_->allocate(data, flags, usageFlags);
+    }
+    void deallocate(cv::UMatData* data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator* base_;
+};
+
+struct Options {
+    std::string filter;
+    std::vector<std::string> sizes = {"4k"};
+    std::vector<int> threads;
+    int iterations = 0; // 0表示按图像大小自动选择
+    std::string jsonPath;
+};
+
+struct Input {
+    std::string name;
+    cv::Mat image;
+    std::string ppmPath;   // 同一图像存成的PPM/PNG文件，用于读取类用例
+    std::string pngPath;
+};
+
+struct Result {
+    std::string benchCase;
+    std::string param;
+    std::string input;
+    int width = 0;
+    int height = 0;
+    int threads = 1;
+    int iterations = 0;
+    double medianNs = 0;
+    double nsPerPixel = 0;
+    double megapixelsPerSecond = 0;
+    double gigabytesPerSecond = 0;  // 按输入图像的字节数计算
+    double allocationsPerCall = 0;
+    double allocatedBytesPerCall = 0;
+    double speedup = 1;             // 相对--threads中第一个线程数（默认为1）的加速比
+};
+
+// setup不计时（例如为原地修改的阶段准备输入副本），body计时并统计分配
+struct BenchCase {
+    std::string name;
+    std::string param;
+    std::function<void()> setup;
+    std::function<void()> body;
+};
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+bool parseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : std::string(); };
+        if (arg == "--filter") {
+            options.filter = next();
+        } else if (arg == "--sizes") {
+            options.sizes = splitList(next());
+        } else if (arg == "--threads") {
+            for (const auto& item : splitList(next())) {
+                options.threads.push_back(std::max(1, std::atoi(item.c_str())));
+            }
+        } else if (arg == "--iterations") {
+            options.iterations = std::max(1, std::atoi(next().c_str()));
+        } else if (arg == "--json") {
+            options.jsonPath = next();
+        } else {
+            return false;
+        }
+    }
+    if (options.threads.empty()) {
+        int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int n = 1; n < cores; n *= 2) {
+            options.threads.push_back(n);
+        }
+        options.threads.push_back(cores);
+    }
+    return true;
+}
+
+// 平滑渐变叠加纹理与色块，使模糊、饱和度、RLE等都有代表性的工作量
+cv::Mat makeSynthetic(int width, int height) {
+    cv::Mat image(height, width, CV_8UC3);
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            uchar* row = image.ptr<uchar>(y);
+            for (int x = 0; x < width; ++x) {
+                bool block = ((x / 256) + (y / 256)) % 3 == 0;
+                row[3 * x] = block ? 40 : static_cast<uchar>(x * 255 / width);
+                row[3 * x + 1] = block ? 180 : static_cast<uchar>(y * 255 / height);
+                row[3 * x + 2] = block ? 90 : static_cast<uchar>((x * 7 + y * 13) & 255);
+            }
+        }
+    });
+    return image;
+}
+
+bool loadInputs(const Options& options, const fs::path& tempDir, std::vector<Input>& inputs) {
+    const std::string dir = IMAGE_RESOURCE_DIR;
+    for (const char* name : {"lena.png", "lena-512-gray.ppm", "color-block.ppm"}) {
+        Input input;
+        input.name = name;
+        input.image = readImage(dir + "/" + name);
+        if (input.image.empty()) {
+            std::cerr << "无法读取图像: " << dir << "/" << name << std::endl;
+            return false;
+        }
+        inputs.push_back(input);
+    }
+    for (const auto& size : options.sizes) {
+        Input input;
+        input.name = "synthetic-" + size;
+        if (size == "4k") {
+            input.image = makeSynthetic(3840, 2160);
+        } else if (size == "8k") {
+            input.image = makeSynthetic(7680, 4320);
+        } else if (size == "16k") {
+            input.image = makeSynthetic(15360, 8640);
+        } else {
+            std::cerr << "未知的合成图像尺寸: " << size << std::endl;
+            return false;
+        }
+        inputs.push_back(input);
+    }
+    // 所有输入统一写成PPM与PNG，读取类用例从这些文件计时
+    for (auto& input : inputs) {
+        std::string stem = (tempDir / input.name).string();
+        input.ppmPath = stem + ".ppm";
+        input.pngPath = stem + ".png";
+        writePPM(input.ppmPath, input.image);
+        cv::imwrite(input.pngPath, input.image);
+    }
+    return true;
+}
+
+std::vector<BenchCase> makeCases(const Input& input, const fs::path& tempDir, cv::Mat& work) {
+    const cv::Mat& image = input.image;
+    auto copyInput = [&]() { image.copyTo(work); };
+    auto none = []() {};
+    std::vector<BenchCase> cases;
+
+    cases.push_back({"readImage", "ppm", none, [&]() { work = readImage(input.ppmPath); }});
+    cases.push_back({"readImage", "png", none, [&]() { work = readImage(input.pngPath); }});
+    cases.push_back({"readPPM", "", none, [&]() { work = readPPM(input.ppmPath); }});
+    cases.push_back({"readImagePreview", "ppm", none, [&]() { work = readImagePreview(input.ppmPath); }});
+    // 解码缓存命中：只映射缓存文件，不解码也不复制像素（首次载入在这里完成）
+    auto cache = std::make_shared<DecodeCache>((tempDir / "decode-cache").string());
+    cache->load(input.pngPath);
+    cases.push_back({"DecodeCache::load", "png hit", none, [&, cache]() { work = cache->load(input.pngPath); }});
+    std::string outPath = (tempDir / "bench-output.ppm").string();
+    cases.push_back({"writePPM", "", none, [&image, outPath]() { writePPM(outPath, image); }});
+    cases.push_back({"convertToGrayscale", "", none, [&]() { work = convertToGrayscale(image); }});
+    cases.push_back({"resizeImage", "50%", none, [&]() { work = resizeImage(image, image.cols / 2, image.rows / 2); }});
+    cases.push_back({"resizeImage", "200%", none, [&]() { work = resizeImage(image, image.cols * 2, image.rows * 2); }});
+    // 整图画到1280x800的视口：cold每次都使金字塔失效（图像刚更新后的第一帧），warm只用已建好的瓦片
+    auto pyramid = std::make_shared<ImagePyramid>();
+    cv::Rect2d fullView(0, 0, image.cols, image.rows);
+    cases.push_back({"ImagePyramid::render", "cold fit", none, [&, pyramid, fullView]() {
+        pyramid->setImage(image);
+        pyramid->render(fullView, cv::Size(1280, 800), work);
+    }});
+    cases.push_back({"ImagePyramid::render", "warm fit", none, [&, pyramid, fullView]() { pyramid->render(fullView, cv::Size(1280, 800), work); }});
+
+    auto compressed = std::make_shared<std::vector<uchar>>(compressImage(image));
+    cases.push_back({"compressImage", "", none, [&image, compressed]() { *compressed = compressImage(image); }});
+    cases.push_back({"decompressImage", "", none, [&, compressed]() { work = decompressImage(*compressed); }});
+    JpegSearchOptions jpegBySize;
+    jpegBySize.maxBytes = image.total() / 8; // 约为原始BGR数据的1/24
+    cases.push_back({"searchJpegQuality", "maxBytes", none, [&image, jpegBySize]() { searchJpegQuality(image, jpegBySize); }});
+    JpegSearchOptions jpegBySsim;
+    jpegBySsim.minSsim = 0.95;
+    cases.push_back({"searchJpegQuality", "ssim0.95", none, [&image, jpegBySsim]() { searchJpegQuality(image, jpegBySsim); }});
+
+    // 处理链各阶段，参数取滑块范围内的典型值
+    for (int blur : {1, 5, 10, 20}) {
+        cases.push_back({"blur", std::to_string(blur), copyInput, [&, blur]() { applyBlurStage(work, work, blur); }});
+    }
+    for (BlurMethod method : {BlurMethod::Box, BlurMethod::Recursive}) {
+        for (int blur : {5, 20}) {
+            std::string param = std::string(blurMethodName(method)) + "," + std::to_string(blur);
+            cases.push_back({"blur", param, copyInput, [&, blur, method]() { applyBlurStage(work, work, blur, 1.0, method); }});
+        }
+    }
+    for (int saturation : {-50, 50}) {
+        cases.push_back({"saturation", std::to_string(saturation), copyInput, [&, saturation]() { applySaturationStage(work, work, saturation); }});
+    }
+    for (int contrast : {-50, 50}) {
+        cases.push_back({"contrast", std::to_string(contrast), copyInput, [&, contrast]() { applyContrastStage(work, work, contrast); }});
+    }
+    for (int sharpen : {1, 5, 20}) {
+        cases.push_back({"sharpen", std::to_string(sharpen), copyInput, [&, sharpen]() { applySharpenStage(work, work, sharpen); }});
+    }
+    cases.push_back({"grayscale", "", copyInput, [&]() { applyGrayscaleStage(work, work, true); }});
+    cases.push_back({"resize", "640x480", copyInput, [&]() { applyResizeStage(work, work, true, 640, 480); }});
+
+    PipelineParams params;
+    params.blur = 3;
+    params.saturation = 20;
+    params.contrast = -10;
+    params.sharpen = 5;
+    params.grayscale = false;
+    cases.push_back({"pipeline", formatPipelineSpec(params), none, [&, params]() { work = applyPipeline(image, params); }});
+    PipelineParams lutParams = params;
+    lutParams.lutSize = 33;
+    cases.push_back({"pipeline", formatPipelineSpec(lutParams), none, [&, lutParams]() { work = applyPipeline(image, lutParams); }});
+    // 同一处理链按块融合执行：块数与线程数都跟随--threads（cv::setNumThreads），speedup即为1到N核的扩展性
+    cases.push_back({"pipeline-tiled", formatPipelineSpec(params), none, [&, params]() { work = applyPipelineTiled(image, params); }});
+    PipelineParams heavyParams = params;
+    heavyParams.blur = 10;
+    heavyParams.blurMethod = BlurMethod::Box;
+    cases.push_back({"pipeline", formatPipelineSpec(heavyParams), none, [&, heavyParams]() { work = applyPipeline(image, heavyParams); }});
+    cases.push_back({"pipeline-tiled", formatPipelineSpec(heavyParams), none, [&, heavyParams]() { work = applyPipelineTiled(image, heavyParams); }});
+
+    // 常见的启用组合：逐阶段执行（每个阶段各自遍历整幅图像，运行时判断参数）与按组合特化的融合内核。
+    // 只有启用锐化或灰度时才走融合内核，只含饱和度/对比度的组合两边是同一条路径，不列出
+    for (const char* spec : {"saturation=20,grayscale", "blur=3,sharpen=5", "sharpen=5,grayscale", "saturation=20,contrast=-10,sharpen=5,grayscale"}) {
+        PipelineParams combo;
+        parsePipelineSpec(spec, combo);
+        cases.push_back({"stages", spec, copyInput, [&, combo]() {
+            applyBlurStage(work, work, combo.blur);
+            applySaturationStage(work, work, combo.saturation);
+            applyContrastStage(work, work, combo.contrast);
+            applySharpenStage(work, work, combo.sharpen);
+            applyGrayscaleStage(work, work, combo.grayscale);
+        }});
+        cases.push_back({"fused", spec, copyInput, [&, combo]() { applyFilterStages(work, combo); }});
+    }
+
+    // 界面拖动滑块时的稳定状态：不缓存阶段结果，每次重算全部阶段，输出缓冲区从池中复用
+    auto staged = std::make_shared<StagedPipeline>(0);
+    staged->setSource(image);
+    cases.push_back({"render", "pooled", none, [&, staged, params]() { work = staged->render(params); }});
+    return cases;
+}
+
+Result runCase(const BenchCase& benchCase, const Input& input, int threads, int iterations) {
+    cv::setNumThreads(threads);
+    benchCase.setup();
+    benchCase.body(); // 预热：建立查找表、线程池等
+
+    std::vector<double> samples;
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    for (int i = 0; i < iterations; ++i) {
+        benchCase.setup();
+        size_t allocationsBefore = gAllocations.load();
+        size_t bytesBefore = gAllocatedBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        benchCase.body();
+        auto end = std::chrono::steady_clock::now();
+        allocations += gAllocations.load() - allocationsBefore;
+        allocatedBytes += gAllocatedBytes.load() - bytesBefore;
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.benchCase = benchCase.name;
+    result.param = benchCase.param;
+    result.input = input.name;
+    result.width = input.image.cols;
+    result.height = input.image.rows;
+    result.threads = threads;
+    result.iterations = iterations;
+    result.medianNs = samples[samples.size() / 2];
+    const double pixels = static_cast<double>(input.image.total());
+    const double bytes = static_cast<double>(input.image.total() * input.image.elemSize());
+    result.nsPerPixel = result.medianNs / pixels;
+    result.megapixelsPerSecond = pixels / result.medianNs * 1e3;
+    result.gigabytesPerSecond = bytes / result.medianNs;
+    result.allocationsPerCall = static_cast<double>(allocations) / iterations;
+    result.allocatedBytesPerCall = static_cast<double>(allocatedBytes) / iterations;
+    return result;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "无法写入JSON文件: " << path << std::endl;
+        return;
+    }
+    file << "{\n"
+         << "  \"schema\": 1,\n"
+         << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n"
+         << "  \"opencv\": \"" << CV_VERSION << "\",\n"
+         << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+         << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        file << "    {\"case\": \"" << jsonEscape(r.benchCase) << "\", \"param\": \"" << jsonEscape(r.param)
+             << "\", \"input\": \"" << jsonEscape(r.input) << "\", \"width\": " << r.width << ", \"height\": " << r.height
+             << ", \"threads\": " << r.threads << ", \"iterations\": " << r.iterations
+             << ", \"median_ns\": " << r.medianNs << ", \"ns_per_pixel\": " << r.nsPerPixel
+             << ", \"mpixels_per_s\": " << r.megapixelsPerSecond << ", \"gb_per_s\": " << r.gigabytesPerSecond
+             << ", \"allocs_per_call\": " << r.allocationsPerCall << ", \"alloc_bytes_per_call\": " << r.allocatedBytesPerCall
+             << ", \"speedup\": " << r.speedup << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+} // namespace
+
+// 统计所有C++堆分配（OpenCV内部的std::vector等也会经过这里）
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--sizes 4k,8k,16k] [--threads 1,2,4] [--iterations n] [--json <file>]" << std::endl;
+        return 2;
+    }
+
+    CountingMatAllocator allocator(cv::Mat::getStdAllocator());
+    cv::Mat::setDefaultAllocator(&allocator);
+
+    fs::path tempDir = fs::temp_directory_path() / "image_processing_bench";
+    std::error_code ec;
+    fs::create_directories(tempDir, ec);
+
+    std::vector<Input> inputs;
+    if (!loadInputs(options, tempDir, inputs)) {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    cv::Mat work;
+    for (const auto& input : inputs) {
+        std::cout << input.name << " (" << input.image.cols << "x" << input.image.rows << ")" << std::endl;
+        // 小图多跑几次，16K只跑几次即可得到稳定的中位数
+        int iterations = options.iterations > 0 ? options.iterations
+                                                : static_cast<int>(std::clamp<double>(2e8 / input.image.total(), 3, 50));
+        for (const auto& benchCase : makeCases(input, tempDir, work)) {
+            std::string label = benchCase.name + (benchCase.param.empty() ? "" : "(" + benchCase.param + ")");
+            if (!options.filter.empty() && label.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            double singleThreadNs = 0;
+            for (int threads : options.threads) {
+                Result result = runCase(benchCase, input, threads, iterations);
+                if (threads == options.threads.front()) {
+                    singleThreadNs = result.medianNs;
+                }
+                result.speedup = singleThreadNs / result.medianNs;
+                std::cout << "  " << label << " threads=" << threads
+                          << ": " << result.nsPerPixel << " ns/px, " << result.megapixelsPerSecond << " MP/s, "
+                          << result.gigabytesPerSecond << " GB/s, " << result.allocationsPerCall << " allocs ("
+                          << result.allocatedBytesPerCall / (1 << 20) << " MB), speedup " << result.speedup << "x" << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+
+    cv::setNumThreads(-1);
+    cv::Mat::setDefaultAllocator(nullptr);
+    if (!options.jsonPath.empty()) {
+        writeJson(options.jsonPath, results);
+        std::cout << "Results written to " << options.jsonPath << std::endl;
+    }
+    fs::remove_all(tempDir, ec);
+    return 0;
+}
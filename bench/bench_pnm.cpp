@@ -0,0 +1,77 @@
+// PPM读取性能对比：原生PNM解析 vs OpenCV imread vs 旧的Python/PIL转换路径
+// 用法: bench_pnm [图像路径] [迭代次数]
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "image_utils.h"
+#include "pnm_reader.h"
+
+namespace {
+
+double medianMillis(int iterations, const std::function<cv::Mat()>& load, cv::Mat& result) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        result = load();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void report(const std::string& name, double ms, const cv::Mat& image, double baseline) {
+    std::cout << name << ": " << ms << " ms";
+    if (baseline > 0) {
+        std::cout << " (" << baseline / ms << "x vs native)";
+    }
+    std::cout << ", " << image.cols << "x" << image.rows << "x" << image.channels() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : std::string(IMAGE_RESOURCE_DIR) + "/lena-512-gray.ppm";
+    int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+    std::cout << "File: " << path << ", iterations: " << iterations << std::endl;
+
+    cv::Mat native;
+    double nativeMs = medianMillis(iterations, [&]() { return readPPM(path); }, native);
+    if (native.empty()) {
+        std::cerr << "无法读取图像: " << path << std::endl;
+        return 1;
+    }
+    report("readPPM (native, BGR)", nativeMs, native, 0);
+
+    cv::Mat unchanged;
+    double unchangedMs = medianMillis(iterations, [&]() { return readPNM(path, cv::IMREAD_UNCHANGED); }, unchanged);
+    report("readPNM (native, unchanged)", unchangedMs, unchanged, nativeMs);
+
+    cv::Mat opencv;
+    double opencvMs = medianMillis(iterations, [&]() { return cv::imread(path, cv::IMREAD_COLOR); }, opencv);
+    report("cv::imread", opencvMs, opencv, nativeMs);
+    if (!opencv.empty() && opencv.size() == native.size()) {
+        std::cout << "  max abs diff vs native: " << cv::norm(opencv, native, cv::NORM_INF) << std::endl;
+    }
+
+#ifdef IMAGE_UTILS_WITH_PYTHON
+    // 旧路径每次都会启动解释器并在输入旁写出PNG，迭代次数过多没有意义
+    cv::Mat python;
+    double pythonMs = medianMillis(std::min(iterations, 5), [&]() { return readPPMWithPython(path); }, python);
+    report("readPPMWithPython (legacy)", pythonMs, python, nativeMs);
+    if (!python.empty() && python.size() == native.size()) {
+        std::cout << "  max abs diff vs native: " << cv::norm(python, native, cv::NORM_INF) << std::endl;
+    }
+#else
+    std::cout << "readPPMWithPython: skipped (configure with -DWITH_PYTHON_PPM=ON)" << std::endl;
+#endif
+
+    return 0;
+}
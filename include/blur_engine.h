@@ -0,0 +1,28 @@
+#ifndef BLUR_ENGINE_H
+#define BLUR_ENGINE_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// 高斯模糊的实现方式
+//   Exact      cv::GaussianBlur，代价随核大小增长
+//   Box        三次级联盒式滤波（滑动窗口求和）近似高斯，每像素代价与半径无关
+//   Recursive  Young-van Vliet三阶递归（IIR）高斯，每像素代价与半径无关
+enum class BlurMethod { Exact, Box, Recursive };
+
+const char* blurMethodName(BlurMethod method);
+bool parseBlurMethod(const std::string& name, BlurMethod& method);
+
+// 与cv::getGaussianKernel在sigma <= 0时的换算一致
+double gaussianSigmaForKernel(int kernelSize);
+
+// 近似高斯模糊（支持原地），仅处理1~4通道8位图像，边界按BORDER_REFLECT_101。
+// method为Exact时直接调用cv::GaussianBlur（核大小按sigma取 2*ceil(3*sigma)+1）。
+// serial为true时在调用线程上完成，不再按行并行（调用方已在并行的任务中，见parallel_rows.h）
+void fastGaussianBlur(const cv::Mat& src, cv::Mat& dst, double sigma, BlurMethod method, bool serial = false);
+
+// 输出行依赖的输入行半径：Box为三次盒式滤波半径之和（精确），
+// Recursive按4*sigma截断（截断误差远小于一个灰度级）
+int blurSupportRadius(double sigma, BlurMethod method);
+
+#endif // BLUR_ENGINE_H
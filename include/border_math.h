@@ -0,0 +1,16 @@
+#ifndef BORDER_MATH_H
+#define BORDER_MATH_H
+
+// 模糊引擎与融合处理链共用的边界取值，与cv::borderInterpolate(BORDER_REFLECT_101)一致。
+// 越界距离超过图像尺寸时（半径大于图像）反复反射
+inline int reflect101(int i, int length) {
+    if (length == 1) {
+        return 0;
+    }
+    while (i < 0 || i >= length) {
+        i = i < 0 ? -i : 2 * length - 2 - i;
+    }
+    return i;
+}
+
+#endif // BORDER_MATH_H
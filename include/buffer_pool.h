@@ -0,0 +1,55 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// 按尺寸与类型复用cv::Mat像素缓冲区，避免每次渲染都重新分配大块内存。
+// 池对借出的每个缓冲区保留一份引用，外部引用全部释放后（引用计数回到1）即自动回到池中，
+// 因此借出的Mat可以像普通Mat一样传递、缓存，不需要显式归还。线程安全。
+class BufferPool {
+public:
+    struct Stats {
+        uint64_t acquires = 0;
+        uint64_t reuses = 0;
+        uint64_t allocations = 0;     // 池中没有可用缓冲区、新分配的次数
+        uint64_t allocatedBytes = 0;  // 新分配的累计字节数
+        size_t pooledBytes = 0;       // 池当前持有的全部缓冲区（含借出中的）
+        size_t idleBytes = 0;         // 其中空闲的部分
+    };
+
+    explicit BufferPool(size_t idleBudget = 256u << 20);
+
+    // 借出rows x cols、type类型的缓冲区，内容未初始化
+    cv::Mat acquire(int rows, int cols, int type);
+    cv::Mat acquire(cv::Size size, int type) { return acquire(size.height, size.width, type); }
+
+    // 放开调用方的引用，并把超出空闲上限的缓冲区（最久未用的优先）真正释放
+    void recycle(cv::Mat& buffer);
+
+    void setIdleBudget(size_t bytes);
+    void trim(); // 释放全部空闲缓冲区
+    Stats stats() const;
+
+private:
+    struct Slot {
+        cv::Mat buffer;
+        uint64_t lastUse = 0;
+    };
+
+    void trimLocked(size_t idleLimit);
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    size_t idleBudget_;
+    uint64_t clock_ = 0;
+    Stats stats_;
+};
+
+// 处理链各阶段、缓存与界面显示共用的缓冲区池
+BufferPool& sharedBufferPool();
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,30 @@
+#ifndef COLOR_KERNELS_H
+#define COLOR_KERNELS_H
+
+#include <opencv2/opencv.hpp>
+
+// 逐像素颜色运算：饱和度 -> 对比度 -> 灰度，参数含义与PipelineParams相同
+struct ColorOps {
+    int saturation = 0;
+    int contrast = 0;
+    bool grayscale = false;
+
+    bool any() const { return saturation != 0 || contrast != 0 || grayscale; }
+};
+
+// 单次遍历完成所有启用的颜色运算（支持原地，dst可以与src相同）
+// 处理CV_8UC3与CV_8UC1（单通道没有色相，饱和度与灰度不改变像素，只做对比度）；
+// 其他类型或自检未通过时自动退回applyColorOpsReference
+// serial为true时在调用线程上完成，不再按行并行
+void applyColorOps(const cv::Mat& src, cv::Mat& dst, const ColorOps& ops, bool serial = false);
+
+// 原有的OpenCV实现（cvtColor/split/merge/convertTo），作为数值基准与回退路径
+void applyColorOpsReference(cv::Mat& image, const ColorOps& ops);
+
+// 首次调用时用随机像素与参数比对融合内核和OpenCV结果，之后返回缓存的结论
+bool colorKernelMatchesOpenCV();
+
+// 当前融合内核使用的指令集："avx2"、"sse4.1"、"neon"或"scalar"
+const char* colorKernelIsa();
+
+#endif // COLOR_KERNELS_H
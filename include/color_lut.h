@@ -0,0 +1,42 @@
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "color_kernels.h"
+
+// 三维颜色查找表（3D LUT）。任意逐像素颜色变换只在size³个格点上求值一次（烘焙），
+// 之后每个像素做一次四面体插值，代价与叠加了多少颜色运算无关。
+// 格点输出以0~255的浮点BGR保存，可与.cube文件（RGB，取值0~1）互相转换。
+class ColorLUT3D {
+public:
+    static const int kDefaultSize = 33;
+    static const int kMaxSize = 256;
+
+    // 在格点上求transform的值：输入为CV_8UC3的格点图像，输出须为同尺寸的CV_8UC3；尺寸无效时返回空表
+    static ColorLUT3D bake(int size, const std::function<void(const cv::Mat&, cv::Mat&)>& transform);
+
+    bool empty() const { return size_ == 0; }
+    int size() const { return size_; }
+
+    // 逐像素四面体插值，按行并行（serial为true时在调用线程上完成；支持原地，dst可以与src相同）；仅处理CV_8UC3
+    void apply(const cv::Mat& src, cv::Mat& dst, bool serial = false) const;
+
+    // 读写.cube文件（LUT_3D_SIZE，定义域须为0~1）；失败时输出错误信息并返回false
+    bool loadCube(const std::string& path);
+    bool saveCube(const std::string& path, const std::string& title = std::string()) const;
+
+private:
+    int size_ = 0;
+    std::vector<float> table_; // 每个格点4个float（B、G、R、对齐用的0），b变化最快：((r * size + g) * size + b) * 4
+};
+
+// 把ops烘焙为size³的LUT；grading（可为空）接在饱和度/对比度之后、灰度之前。结果按参数缓存，参数不变时直接复用，
+// 拖动滑块时只有参数变化的那一次需要重新烘焙。线程安全
+std::shared_ptr<const ColorLUT3D> compileColorLUT(const ColorOps& ops, int size,
+                                                  const std::shared_ptr<const ColorLUT3D>& grading = nullptr);
+
+#endif // COLOR_LUT_H
@@ -0,0 +1,87 @@
+#ifndef COLOR_MATH_H
+#define COLOR_MATH_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+
+// 融合颜色内核与融合处理链共用的逐像素运算，逐位复现OpenCV 8位实现的定点/单精度计算。
+// 使用这些函数的源文件需要关闭FMA合并（-ffp-contract=off，见CMakeLists.txt）
+
+// 与OpenCV 8位BGR2HSV/BGR2GRAY的定点实现保持一致
+constexpr int kHsvShift = 12;
+constexpr int kHueRange = 180;
+constexpr float kHueScale = 6.0f / kHueRange;
+constexpr int kGrayShift = 15;
+constexpr int kBlueToGray = 3735;   // 0.114 * 32768
+constexpr int kGreenToGray = 19235; // 0.587 * 32768
+constexpr int kRedToGray = 9798;    // 0.299 * 32768
+
+struct HsvTables {
+    int sdiv[256];
+    int hdiv[256];
+
+    HsvTables() {
+        sdiv[0] = hdiv[0] = 0;
+        for (int i = 1; i < 256; ++i) {
+            sdiv[i] = cv::saturate_cast<int>((255 << kHsvShift) / (1. * i));
+            hdiv[i] = cv::saturate_cast<int>((kHueRange << kHsvShift) / (6. * i));
+        }
+    }
+};
+
+inline const HsvTables& hsvTables() {
+    static const HsvTables tables;
+    return tables;
+}
+
+inline void bgrToHsv(int b, int g, int r, const HsvTables& tables, int& h, int& s, int& v) {
+    v = std::max(std::max(b, g), r);
+    int vmin = std::min(std::min(b, g), r);
+    int diff = v - vmin;
+    int vr = v == r ? -1 : 0;
+    int vg = v == g ? -1 : 0;
+
+    s = (diff * tables.sdiv[v] + (1 << (kHsvShift - 1))) >> kHsvShift;
+    h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+    h = (h * tables.hdiv[diff] + (1 << (kHsvShift - 1))) >> kHsvShift;
+    h += h < 0 ? kHueRange : 0;
+}
+
+// 与OpenCV的HSV2RGB_b相同的单精度计算顺序（本文件关闭了FMA合并，见CMakeLists.txt）
+inline void hsvToBgr(int hue, int sat, int val, int& b, int& g, int& r) {
+    static constexpr int sectorData[6][3] = {{1, 3, 0}, {1, 0, 2}, {3, 0, 1}, {0, 2, 1}, {0, 1, 3}, {2, 1, 0}};
+    float h = static_cast<float>(hue);
+    float s = sat * (1.0f / 255.0f);
+    float v = static_cast<float>(val);
+    float fb, fg, fr;
+    if (s == 0) {
+        fb = fg = fr = v;
+    } else {
+        h *= kHueScale;
+        h = std::fmod(h, 6.f);
+        int sector = cvFloor(h);
+        h -= sector;
+        if (static_cast<unsigned>(sector) >= 6u) {
+            sector = 0;
+            h = 0.f;
+        }
+        float tab[4];
+        tab[0] = v;
+        tab[1] = v * (1.f - s);
+        tab[2] = v * (1.f - s * h);
+        tab[3] = v * (1.f - s * (1.f - h));
+        fb = tab[sectorData[sector][0]];
+        fg = tab[sectorData[sector][1]];
+        fr = tab[sectorData[sector][2]];
+    }
+    b = cv::saturate_cast<uchar>(fb);
+    g = cv::saturate_cast<uchar>(fg);
+    r = cv::saturate_cast<uchar>(fr);
+}
+
+inline int bgrToGray(int b, int g, int r) {
+    return (b * kBlueToGray + g * kGreenToGray + r * kRedToGray + (1 << (kGrayShift - 1))) >> kGrayShift;
+}
+
+#endif // COLOR_MATH_H
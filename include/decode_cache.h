@@ -0,0 +1,56 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// 解码结果的磁盘缓存。每个缓存文件是64字节的文件头加原始像素，命中时直接映射为cv::Mat
+// （写时复制的私有映射，不拷贝像素，最后一个引用释放时解除映射）。
+// 缓存文件按源文件内容的哈希命名，内容相同的文件换了路径也能命中；另有按 路径 + 修改时间 + 大小
+// 命名的引用文件，源文件没有变化时不必重新读取整个文件计算哈希。
+// 像素文件与引用文件的总大小超过上限时按最近使用时间淘汰像素文件，指向已不存在的像素文件的引用随之删除。线程安全
+class DecodeCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t bytes = 0;    // 缓存目录中像素文件与引用文件的总大小
+        size_t entries = 0;
+    };
+
+    explicit DecodeCache(const std::string& directory, size_t sizeLimit = size_t(2) << 30);
+
+    // 命中时返回映射缓存文件的图像；否则用readImage解码并写入缓存。hit非空时写入是否命中
+    cv::Mat load(const std::string& path, bool* hit = nullptr);
+    // 只查引用文件（不读取源文件、不解码）：该路径的文件未变化且已缓存时返回映射的图像，否则返回空Mat
+    cv::Mat lookup(const std::string& path);
+
+    void setSizeLimit(size_t bytes);
+    size_t sizeLimit() const;
+    const std::string& directory() const { return directory_; }
+    Stats stats() const;
+
+private:
+    bool refPathFor(const std::string& path, std::string& refPath) const;
+    cv::Mat mapEntry(uint64_t contentHash) const;
+    bool store(uint64_t contentHash, const cv::Mat& image);
+    void scanLocked();
+    void evictLocked();
+
+    std::string directory_;
+    mutable std::mutex mutex_;
+    size_t sizeLimit_;
+    Stats stats_;
+};
+
+// $IMAGE_CACHE_DIR；未设置时为$XDG_CACHE_HOME/ImageProcessing或~/.cache/ImageProcessing
+std::string defaultDecodeCacheDirectory();
+
+// 界面使用的缓存，目录为defaultDecodeCacheDirectory()
+DecodeCache& sharedDecodeCache();
+
+#endif // DECODE_CACHE_H
@@ -0,0 +1,84 @@
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "pipeline.h"
+
+// 多步撤销/重做。处理链是非破坏性的，一个编辑状态就是一组PipelineParams：
+// 每一步只记录与上一步不同的参数（增量），每隔keyframeInterval步记录一个关键帧（完整参数），
+// 关键帧上还可以附带该状态渲染结果的RLE压缩快照。撤销/重做时从最近的关键帧开始重放增量重建参数，
+// 目标步骤带快照时可直接解码显示，不必等待重新渲染。
+// 总内存受上限约束：超出时先丢弃最旧的快照，再丢弃最旧的步骤（其后一步转为关键帧）。
+class EditHistory {
+public:
+    struct Options {
+        size_t memoryBudget = 64u << 20;
+        int keyframeInterval = 8;
+        size_t maxSteps = 1000;
+    };
+
+    struct Stats {
+        size_t steps = 0;
+        size_t position = 0;      // 当前状态在历史中的序号（0为最早）
+        size_t keyframes = 0;
+        size_t snapshots = 0;
+        size_t memoryUsage = 0;   // 步骤、增量与快照占用的字节数
+    };
+
+    EditHistory() : EditHistory(Options()) {}
+    explicit EditHistory(const Options& options);
+
+    // 清空历史，以initial为唯一的状态
+    void reset(const PipelineParams& initial);
+
+    // 记录新状态并丢弃重做分支；与当前状态相同时忽略并返回false
+    bool push(const PipelineParams& params);
+
+    // 当前状态是关键帧且还没有快照时返回true
+    bool wantsSnapshot() const;
+    // 把当前状态的渲染结果压缩后附加到关键帧上（wantsSnapshot()为false时忽略）
+    void attachSnapshot(const cv::Mat& rendered);
+    // 渲染输入变化（例如预览代理图重建）后，已有快照不再对应当前显示，全部丢弃
+    void dropSnapshots();
+
+    bool canUndo() const { return position_ > 0; }
+    bool canRedo() const { return position_ + 1 < steps_.size(); }
+    // 移动到上一个/下一个状态，params为重建的参数；目标状态带快照且snapshot非空时解码到*snapshot，否则置空
+    bool undo(PipelineParams& params, cv::Mat* snapshot = nullptr);
+    bool redo(PipelineParams& params, cv::Mat* snapshot = nullptr);
+
+    PipelineParams current() const;
+    Stats stats() const;
+    size_t memoryUsage() const;
+
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const { return options_.memoryBudget; }
+
+private:
+    // 单个参数的变化：字段编号与新值
+    struct Change {
+        uint8_t field;
+        int32_t value;
+    };
+
+    struct Step {
+        bool keyframe = false;
+        PipelineParams params;       // 仅关键帧有效
+        std::vector<Change> changes; // 相对上一步的增量，关键帧为空
+        std::vector<uchar> snapshot; // 仅关键帧可能有
+    };
+
+    PipelineParams paramsAt(size_t index) const;
+    bool moveTo(size_t index, PipelineParams& params, cv::Mat* snapshot);
+    void enforceBudget();
+
+    Options options_;
+    std::deque<Step> steps_;
+    size_t position_ = 0;
+};
+
+#endif // EDIT_HISTORY_H
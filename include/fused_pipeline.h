@@ -0,0 +1,31 @@
+#ifndef FUSED_PIPELINE_H
+#define FUSED_PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include "pipeline.h"
+
+// 模糊之后的阶段（饱和度 -> 对比度 -> 锐化 -> 灰度）按启用组合在编译期特化的融合内核：
+// 每种组合各实例化一份逐行内核，关闭的阶段不产生任何代码，由启用阶段的位掩码查表选择。
+// 锐化的3x3邻域用三行环形缓冲（每行先做完逐像素运算），锐化结果直接在寄存器中转为灰度，
+// 整个过程只读一遍输入、写一遍输出，中间结果不写回整幅图像。
+enum FusedStage : unsigned {
+    FusedSaturation = 1u << 0,
+    FusedContrast = 1u << 1,
+    FusedSharpen = 1u << 2,
+    FusedGrayscale = 1u << 3,
+    FusedStageCombinations = 1u << 4,
+};
+
+// 参数中启用的阶段；单通道图像没有饱和度与灰度运算，对应的位总是0
+unsigned fusedStageMask(const PipelineParams& params, int channels);
+
+// 对CV_8UC3/CV_8UC1执行饱和度、对比度、锐化与灰度阶段（不含模糊、调色表与尺寸调整），dst可以与src相同。
+// 启用阶段不含锐化或灰度时（applyColorOps已是单次遍历）、类型不支持或自检未通过时返回false，不修改dst，
+// 调用方按阶段逐个执行。serial为true时在调用线程上完成，不再按行并行
+bool applyFusedStages(const cv::Mat& src, cv::Mat& dst, const PipelineParams& params, bool serial = false);
+
+// 首次调用时用随机像素比对全部组合与逐阶段执行的结果，之后返回缓存的结论。
+// 锐化的单精度累加与OpenCV filter2D的SIMD实现（可能使用FMA）在舍入边界上可能相差1，允许该误差
+bool fusedStagesMatchOpenCV();
+
+#endif // FUSED_PIPELINE_H
@@ -0,0 +1,58 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// 按需构建的多分辨率金字塔（mipmap），用于缩放/平移大图。第0层直接引用源图像，
+// 之后每层长宽减半（INTER_AREA）。每层划分为tileSize x tileSize的瓦片，只有视口用到的瓦片
+// 才从上一层（更精细的一层）对应区域降采样得到，因此每帧的代价约为视口大小，而不是原图大小。
+// 源图像变化后调用setImage使各层全部失效（各层的缓冲区保留给新图像复用）。非线程安全，供界面线程使用
+class ImagePyramid {
+public:
+    static const int kDefaultTileSize = 256;
+
+    struct Stats {
+        uint64_t tilesBuilt = 0;  // 自上次setImage以来计算的瓦片数
+        size_t levelBytes = 0;    // 第1层及以上已分配的字节数
+    };
+
+    explicit ImagePyramid(int tileSize = kDefaultTileSize);
+
+    // 替换源图像（只引用不复制），其余各层全部失效；尺寸与类型不变时各层沿用原有的缓冲区
+    void setImage(const cv::Mat& image);
+    void clear();
+
+    bool empty() const { return levels_.empty(); }
+    cv::Size size() const;
+    int levelCount() const { return static_cast<int>(levels_.size()); }
+
+    // 分辨率不低于scale（显示像素/源像素）的最粗一层
+    int levelForScale(double scale) const;
+
+    // 把源图像坐标下的区域view渲染为dstSize的图像（dst的尺寸与类型不变时直接写入）。
+    // view可以超出图像范围，超出部分填background
+    void render(const cv::Rect2d& view, cv::Size dstSize, cv::Mat& dst, const cv::Scalar& background = cv::Scalar());
+
+    Stats stats() const { return stats_; }
+
+private:
+    struct Level {
+        cv::Size size;
+        cv::Mat image;              // 第一次用到时才分配（或沿用上一幅图像同一层的缓冲区）
+        int tilesX = 0;
+        int tilesY = 0;
+        std::vector<uint8_t> ready; // 每个瓦片是否已经计算，为空表示本层还没有用到
+    };
+
+    // 保证level层中rect覆盖的瓦片都已计算
+    void ensure(int level, const cv::Rect& rect);
+    void buildTile(int level, int tileX, int tileY);
+
+    int tileSize_;
+    std::vector<Level> levels_;
+    Stats stats_;
+};
+
+#endif // IMAGE_PYRAMID_H
@@ -5,11 +5,23 @@
 #include <string>
 #include <vector>
 
-cv::Mat readImage(const std::string& path);
-cv::Mat readPPM(const std::string& path);
-void writePPM(const std::string& path, const cv::Mat& image);
+// 扩展名判断不区分大小写：lowerExtension返回小写的扩展名（不含点），没有扩展名时为空
+std::string lowercase(std::string text);
+std::string lowerExtension(const std::string& path);
+
+cv::Mat readImage(const std::string& path);  // 保留通道数：灰度文件为CV_8UC1，其余为BGR
+cv::Mat readPPM(const std::string& path);    // 总是输出BGR
+// 打开大图时的快速预览：JPEG按DCT缩放解码（IMREAD_REDUCED_COLOR_2/4/8），8位二进制PNM在映射内存上隔行隔列取样。
+// 长宽缩小为1/scale（2、4或8），使像素数约不超过maxPixels。图像本身不大或格式不支持快速缩小时返回空Mat
+cv::Mat readImagePreview(const std::string& path, int* scale = nullptr, size_t maxPixels = size_t(2) << 20);
+#ifdef IMAGE_UTILS_WITH_PYTHON
+cv::Mat readPPMWithPython(const std::string& path); // 旧的Python/PIL转换路径，仅用于基准对比
+#endif
+bool writePPM(const std::string& path, const cv::Mat& image); // BGR写为P6，单通道写为P5
+bool writeImage(const std::string& path, const cv::Mat& image); // 按扩展名选择writePPM（.ppm/.pgm/.pnm）、RLE或cv::imwrite
 cv::Mat convertToGrayscale(const cv::Mat& image);
 cv::Mat resizeImage(const cv::Mat& image, int width, int height);
-std::vector<uchar> compressImage(const cv::Mat& image);
+std::vector<uchar> compressImage(const cv::Mat& image);   // 无损RLE，格式见rle_codec.h
+cv::Mat decompressImage(const std::vector<uchar>& data);
 
 #endif // IMAGE_UTILS_H
\ No newline at end of file
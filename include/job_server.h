@@ -0,0 +1,36 @@
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+#include <cstddef>
+#include <string>
+
+// 常驻的处理服务：在Unix域套接字上接收作业，进程启动、OpenCV初始化（以及旧的Python PPM路径）只发生一次。
+// 协议为逐行文本，每行一个命令，字段以制表符分隔，字段形如 key=value（只在第一个'='处分割）：
+//
+//   job  id=<客户端编号>  input=<图像路径>                                  pipeline=<spec>  format=<ext>  [output=<路径>]
+//   job  id=<客户端编号>  shm=<共享内存名> width=<w> height=<h> channels=<1|3> pipeline=<spec>  format=<ext>  [output=<路径>]
+//        shm输入为客户端用shm_open创建的紧密排列的8位像素（BGR或灰度），服务端只读映射、不复制。
+//        收到回复之前客户端不得缩小（ftruncate）或改写该段：映射不复制像素，段被截短后服务端访问时会收到SIGBUS。
+//        format为png、jpg、ppm、pgm或raw（原始像素）；给出output时写入该文件（按扩展名：ppm、pgm、pnm、rle或OpenCV有编码器的格式），
+//        否则结果放入服务端新建的共享内存，回复中给出名称与字节数，客户端映射读取后负责shm_unlink
+//        （回复因客户端断开而无法送达时由服务端删除）。格式或扩展名不受支持时在排队前就回复error。
+//        回复：ok  id=  shm=|output=  bytes=  width=  height=  channels=  batch=  queue_ms=  process_ms=  total_ms=
+//        出错：error  id=  message=
+//   stats     回复：stats  jobs=  failed=  queued=  max_queued=  batches=  avg_batch=  jobs_per_s=  recent_jobs_per_s=
+//                         latency_p50_ms=  latency_p99_ms=  uptime_s=
+//   shutdown  处理完已排队的作业后退出
+//
+// 同一连接上可以连续发送多个作业，回复按完成顺序返回，用id对应。
+// 解码在各连接的线程上进行；调度线程把排队的作业中尺寸与类型相同的合并为一批（最多maxBatch个，
+// 凑批最多等待batchWindowMs），一批多个作业时按作业并行，只有一个作业时在图像内部分块并行。
+struct JobServerOptions {
+    std::string socketPath;
+    int maxBatch = 8;
+    double batchWindowMs = 2.0;
+    size_t maxQueued = 256;  // 排队作业上限，超过时连接线程等待（对客户端形成背压）
+};
+
+// 运行直到收到shutdown命令；返回进程退出码
+int runJobServer(const JobServerOptions& options);
+
+#endif // JOB_SERVER_H
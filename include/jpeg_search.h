@@ -0,0 +1,36 @@
+#ifndef JPEG_SEARCH_H
+#define JPEG_SEARCH_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+// JPEG质量搜索的约束。maxBytes与minSsim都为0时直接按maxQuality编码一次
+struct JpegSearchOptions {
+    size_t maxBytes = 0;          // >0时：不超过该字节数的最高质量（上限内画质最好的编码）
+    double minSsim = 0;           // >0时：亮度SSIM不低于该值的最小文件
+    int minQuality = 1;
+    int maxQuality = 100;
+    bool progressive = false;     // IMWRITE_JPEG_PROGRESSIVE
+    bool optimizeHuffman = false; // IMWRITE_JPEG_OPTIMIZE
+    int parallelism = 0;          // 每轮并行尝试的质量个数，0为cv::getNumThreads()
+};
+
+struct JpegSearchResult {
+    bool satisfied = false;   // 找到了满足全部约束的编码；为false时data为尽力而为的结果
+    int quality = 0;
+    std::vector<uchar> data;
+    double ssim = -1;         // 只在设置了minSsim时计算
+    int encodes = 0;          // 实际编码（不含重复）的次数
+    double seconds = 0;
+};
+
+// 在质量空间中做k叉搜索：每轮并行编码parallelism个均匀分布的质量，把边界缩小到相邻两次尝试之间，
+// 轮数约为log_{k+1}(质量范围)。文件大小与SSIM都近似随质量单调，搜索依赖这一点。
+// 两个约束同时给出时，取满足SSIM的最小文件，再检查它是否在大小上限内
+JpegSearchResult searchJpegQuality(const cv::Mat& image, const JpegSearchOptions& options);
+
+// 两幅同尺寸8位图像亮度通道的平均SSIM（11x11、sigma 1.5的高斯窗）
+double computeSsim(const cv::Mat& reference, const cv::Mat& candidate);
+
+#endif // JPEG_SEARCH_H
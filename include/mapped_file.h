@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 只读内存映射文件，析构时自动解除映射
+// 不支持mmap的平台上退化为一次性读入堆缓冲区
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // copyOnWrite为true时映射为可写的私有副本：写入只触发该页的复制，不会改动文件
+    bool open(const std::string& path, bool copyOnWrite = false);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    const unsigned char* data() const { return data_; }
+    // 只读映射时返回nullptr
+    unsigned char* writableData() { return writable_ ? const_cast<unsigned char*>(data_) : nullptr; }
+    size_t size() const { return size_; }
+
+    // 提示内核[offset, offset + length)已不再需要，可以从常驻内存中释放（之后仍可读取）
+    // 顺序流式读取大文件时用它把常驻页数控制在读取窗口附近；只释放完整的页，返回实际释放到的位置
+    size_t discard(size_t offset, size_t length);
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    bool writable_ = false;
+    std::vector<unsigned char> buffer_;
+};
+
+#endif // MAPPED_FILE_H
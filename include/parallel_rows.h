@@ -0,0 +1,18 @@
+#ifndef PARALLEL_ROWS_H
+#define PARALLEL_ROWS_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+
+// 按行并行执行body；serial为true时在当前线程直接处理整个范围。
+// 分块执行时每块已经占用线程池中的一个线程，块内各阶段传serial，不再各自fork/join，
+// 也不需要改动进程级的cv::setNumThreads（会影响同时在其他线程上运行的OpenCV调用）
+inline void parallelRows(const cv::Range& range, const std::function<void(const cv::Range&)>& body, bool serial) {
+    if (serial) {
+        body(range);
+    } else {
+        cv::parallel_for_(range, body);
+    }
+}
+
+#endif // PARALLEL_ROWS_H
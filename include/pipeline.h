@@ -0,0 +1,54 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include "blur_engine.h"
+#include "color_lut.h"
+
+// 处理链参数，与界面上的滑块/按钮一一对应
+struct PipelineParams {
+    int blur = 0;          // 0..20，核大小为 blur * 2 + 1
+    BlurMethod blurMethod = BlurMethod::Exact; // 大半径时Box/Recursive每像素代价恒定
+    int saturation = 0;    // -100..100，加到HSV的S通道
+    int contrast = 0;      // -100..100，增益为 1 + contrast / 50
+    int sharpen = 0;       // 0..20
+    bool grayscale = false;
+    bool resize = false;
+    int resizeWidth = 100;
+    int resizeHeight = 100;
+    double scale = 1.0;    // 输入相对原图的缩放比例（预览代理 < 1），用于换算模糊与锐化的等效强度
+    int lutSize = 0;       // 0为逐像素精确计算；2..256时把颜色运算烘焙为该尺寸的3D LUT后查表
+    std::shared_ptr<const ColorLUT3D> grading; // 导入的.cube调色表，接在饱和度/对比度之后、灰度之前，可为空
+};
+
+// 单个处理阶段：src -> dst，dst可以与src相同（原地修改）。
+// dst已有正确的尺寸与类型时直接写入，不重新分配。参数为0/false时只在dst与src不同时复制。
+// 各阶段保持输入的通道数（单通道灰度图像全程按单通道处理），只有灰度阶段把BGR转换为单通道
+void applyBlurStage(const cv::Mat& src, cv::Mat& dst, int blur, double scale = 1.0, BlurMethod method = BlurMethod::Exact, bool serial = false);
+void applySaturationStage(const cv::Mat& src, cv::Mat& dst, int saturation);
+void applyContrastStage(const cv::Mat& src, cv::Mat& dst, int contrast);
+void applySharpenStage(const cv::Mat& src, cv::Mat& dst, int sharpen, double scale = 1.0);
+void applyGrayscaleStage(const cv::Mat& src, cv::Mat& dst, bool grayscale);
+
+// 锐化核 [0 e 0; e c e; 0 e 0] 的系数，融合内核与applySharpenStage共用
+void sharpenCoefficients(int sharpen, double scale, float& edge, float& center);
+void applyResizeStage(const cv::Mat& src, cv::Mat& dst, bool resize, int width, int height);
+
+// 依次执行 模糊 -> 饱和度 -> 对比度 -> 锐化 -> 灰度 -> 尺寸调整
+cv::Mat applyPipeline(const cv::Mat& image, const PipelineParams& params);
+
+// 除尺寸调整外的所有阶段（原地修改image），这些阶段的输出行只依赖输入的相邻若干行。
+// serial为true时本项目的内核不再按行并行，供已经按块并行的调用方使用
+void applyFilterStages(cv::Mat& image, const PipelineParams& params, bool serial = false);
+
+// applyFilterStages的每个输出行在上下方向各需要多少输入行（模糊半径 + 锐化核半径）
+int pipelineHaloRows(const PipelineParams& params);
+
+// 文本形式的处理链描述，例如 "blur=3,blurmethod=box,saturation=20,contrast=-10,sharpen=5,grayscale,lut=33,resize=640x480"
+// （grading不在文本描述中，由调用方单独加载）
+bool parsePipelineSpec(const std::string& spec, PipelineParams& params, std::string* error = nullptr);
+std::string formatPipelineSpec(const PipelineParams& params);
+
+#endif // PIPELINE_H
@@ -0,0 +1,47 @@
+#ifndef PNM_READER_H
+#define PNM_READER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include "mapped_file.h"
+
+// PNM文件头（支持P2/P3/P5/P6）
+struct PNMHeader {
+    char format = 0;       // '2' '3' '5' '6'
+    int width = 0;
+    int height = 0;
+    int maxval = 0;
+    int channels = 0;      // 1 = 灰度(P2/P5)，3 = RGB(P3/P6)
+    bool binary = false;   // P5/P6
+    size_t dataOffset = 0; // 像素数据相对文件起始的偏移
+};
+
+bool parsePNMHeader(const unsigned char* data, size_t size, PNMHeader& header);
+
+// 从pos开始按顺序解码dst.rows行到dst，并把pos移到下一行数据处，用于分条读取
+// dst的位深决定输出范围（CV_8U或CV_16U），通道数为文件通道数或3（灰度扩展为BGR）
+bool decodePNMRows(const unsigned char* data, size_t size, const PNMHeader& header, size_t& pos, cv::Mat& dst);
+
+// flags取值与cv::imread一致：
+//   cv::IMREAD_UNCHANGED  保留原始通道数与位深（maxval > 255 时输出CV_16U）
+//   cv::IMREAD_COLOR      输出8位BGR
+//   cv::IMREAD_GRAYSCALE  输出8位单通道
+//   cv::IMREAD_ANYCOLOR   保留原始通道数，输出8位（P2/P5为单通道，P3/P6为BGR）
+cv::Mat decodePNM(const unsigned char* data, size_t size, int flags = cv::IMREAD_UNCHANGED);
+cv::Mat readPNM(const std::string& path, int flags = cv::IMREAD_UNCHANGED);
+
+// 零拷贝访问：映射文件并把P5/P6的8位像素数据直接包装为cv::Mat
+// 返回的Mat保持文件中的通道顺序（P6为RGB），且只在PNMView存活期间有效
+class PNMView {
+public:
+    bool open(const std::string& path);
+    const PNMHeader& header() const { return header_; }
+    bool canWrap() const;
+    cv::Mat image() const;
+
+private:
+    MappedFile file_;
+    PNMHeader header_;
+};
+
+#endif // PNM_READER_H
@@ -0,0 +1,70 @@
+#ifndef RENDER_WORKER_H
+#define RENDER_WORKER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "pipeline.h"
+#include "staged_pipeline.h"
+
+// 渲染完成的一帧
+struct RenderFrame {
+    cv::Mat image;
+    uint64_t generation = 0;                           // 对应的请求序号
+    uint64_t sourceId = 0;                             // 渲染所用输入图像的序号（setSource的返回值）
+    std::chrono::steady_clock::time_point requestTime; // 触发该帧的输入时间
+    double renderMs = 0;                               // 后台渲染耗时
+};
+
+// 后台渲染线程：只保留最新一组参数，中间的滑块值直接丢弃；
+// 新参数到达时在阶段之间取消正在进行的渲染。完成的帧通过回调交出（在工作线程上调用）。
+class RenderWorker {
+public:
+    using FrameCallback = std::function<void(const RenderFrame&)>;
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t rendered = 0;
+        uint64_t coalesced = 0; // 尚未开始渲染就被新参数覆盖
+        uint64_t cancelled = 0; // 渲染途中被取消
+    };
+
+    explicit RenderWorker(FrameCallback onFrame);
+    ~RenderWorker();
+
+    RenderWorker(const RenderWorker&) = delete;
+    RenderWorker& operator=(const RenderWorker&) = delete;
+
+    // 更换输入图像（例如新的预览代理图），会取消正在进行的渲染；返回新输入的序号，
+    // 之后完成的帧带有该序号，界面据此丢弃换图前排队的旧帧
+    uint64_t setSource(const cv::Mat& source);
+    uint64_t request(const PipelineParams& params);
+    Stats stats() const;
+
+private:
+    void run();
+
+    FrameCallback onFrame_;
+    StagedPipeline pipeline_; // 只在工作线程上访问
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool hasRequest_ = false;
+    bool hasSource_ = false;
+    bool stopping_ = false;
+    cv::Mat pendingSource_;
+    uint64_t pendingSourceId_ = 0;
+    PipelineParams pendingParams_;
+    std::chrono::steady_clock::time_point pendingTime_;
+    std::atomic<uint64_t> latestGeneration_{0};
+    Stats stats_;
+
+    std::thread thread_;
+};
+
+#endif // RENDER_WORKER_H
@@ -0,0 +1,28 @@
+#ifndef RLE_CODEC_H
+#define RLE_CODEC_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+// 无损RLE编码，支持CV_8UC1 ~ CV_8UC4。容器格式（整数均为小端）：
+//   0  "RLEI"        魔数
+//   4  u8  版本（1）  u8 通道数   u16 保留
+//   8  u32 宽度       u32 高度
+//   16 u64 × (高度+1) 各行在数据区中的起始偏移，最后一项为数据区总长度
+//   ...               数据区
+// 每行独立编码为若干记号，记号头为varint：(像素数-1) << 1 | 类型
+//   类型1：重复段，后跟1个像素
+//   类型0：原样段，后跟“像素数”个像素
+// 行之间互不依赖，编码与解码都按行并行。
+std::vector<uchar> encodeRLE(const cv::Mat& image);
+
+// 数据不完整或格式不符时返回空Mat；分配输出之前先按行表检查数据量与声明的尺寸是否相符，
+// 像素数超过2^30（与cv::imread的默认上限相同）时也拒绝
+cv::Mat decodeRLE(const uchar* data, size_t size);
+cv::Mat decodeRLE(const std::vector<uchar>& data);
+
+// 数据是否以RLE容器的魔数开头
+bool isRLEData(const uchar* data, size_t size);
+
+#endif // RLE_CODEC_H
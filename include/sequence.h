@@ -0,0 +1,45 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <cstddef>
+#include <string>
+#include "pipeline.h"
+
+// 帧序列/视频处理：解码、处理、编码在各自的线程上流水执行，阶段之间用有界无锁队列（SpscQueue）连接。
+// 第i帧交给第 i % workers 个处理线程，编码线程按同样的顺序轮流取结果，
+// 因此输出顺序与输入一致，也不需要重排缓冲；同时在途的帧数不超过 workers * (2 * queueDepth + 1) + 2。
+// 处理线程之间已经并行，调用方可以用cv::setNumThreads(1)避免OpenCV内部再开线程
+struct SequenceOptions {
+    int workers = 0;        // 处理线程数，0为硬件线程数减2（至少1），解码与编码各占一个线程
+    size_t queueDepth = 4;  // 每个处理线程的输入、输出队列各能缓存的帧数
+    double fps = 0;         // 输出视频的帧率，0时沿用输入视频的帧率（图像序列输入为25）
+    int maxFrames = 0;      // 最多处理的帧数，0为不限
+};
+
+struct SequenceStats {
+    int frames = 0;
+    int workers = 0;
+    double seconds = 0;
+    double decodeSeconds = 0;       // 解码线程花在读取/解码上的时间
+    double processSeconds = 0;      // 各处理线程处理时间之和
+    double encodeSeconds = 0;
+    double decodeStallSeconds = 0;  // 解码线程等待处理队列有空位的时间（处理或编码跟不上）
+    double encodeWaitSeconds = 0;   // 编码线程等待下一帧结果的时间（解码或处理跟不上）
+    double inputOccupancy = 0;      // 每写出一帧采样一次，解码->处理队列的平均占用率（0..1）
+    double outputOccupancy = 0;     // 处理->编码队列的平均占用率
+
+    double fps() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// input：带printf序号格式的路径（如 frames/img_%04d.ppm，从0或1开始到第一个缺失的序号为止）、
+//        图像目录（按文件名排序）或cv::VideoCapture能打开的视频文件。
+// output：带序号格式的路径时逐帧用writeImage写出（序号与输入一致），
+//         否则按扩展名用cv::VideoWriter编码（.avi为MJPG，其他为mp4v）。
+// 对每帧执行与applyPipeline相同的处理链
+bool processSequence(const std::string& input, const std::string& output, const PipelineParams& params,
+                     const SequenceOptions& options = SequenceOptions(), SequenceStats* stats = nullptr);
+
+// path中是否恰好含有一个 %d / %0Nd 形式的序号（%%视为普通字符）
+bool isFrameIndexPattern(const std::string& path);
+
+#endif // SEQUENCE_H
@@ -0,0 +1,103 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// 单生产者单消费者的有界无锁环形队列：push/tryPush只由一个线程调用，pop/tryPop只由另一个线程调用。
+// 读写位置单调递增，各占一个缓存行，并各自缓存对方的位置，只有看起来满/空时才读取对方的原子变量。
+// 队列满或空时先让出CPU，等待较久后改为短暂休眠。close()之后push失败，pop在取完剩余元素后返回false
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {
+        size_t slots = 1;
+        while (slots < capacity_) {
+            slots <<= 1;
+        }
+        slots_.resize(slots);
+        mask_ = slots - 1;
+    }
+
+    bool tryPush(T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ >= capacity_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ >= capacity_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) {
+                return false;
+            }
+        }
+        item = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T(); // 不在队列里多持有一份引用
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(T item) {
+        for (int spins = 0; !tryPush(item); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+    bool pop(T& item) {
+        for (int spins = 0; !tryPop(item); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) {
+                return tryPop(item); // close之前push的元素此时一定可见
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+    // 生产者写完后关闭；消费者提前退出时也可以关闭，使阻塞在push上的生产者返回
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    // 任意线程都可读取的近似元素个数，用于统计占用率
+    size_t size() const {
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    static void backoff(int spins) {
+        if (spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    const size_t capacity_;
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // 消费者写
+    size_t tailCache_ = 0;                     // 消费者看到的tail_
+    alignas(64) std::atomic<size_t> tail_{0}; // 生产者写
+    size_t headCache_ = 0;                     // 生产者看到的head_
+    alignas(64) std::atomic<bool> closed_{false};
+};
+
+#endif // SPSC_QUEUE_H
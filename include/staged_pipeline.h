@@ -0,0 +1,67 @@
+#ifndef STAGED_PIPELINE_H
+#define STAGED_PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include "pipeline.h"
+
+// 带阶段缓存的处理链：每个阶段的输出按“该阶段及之前所有参数”缓存，
+// 只有被修改的阶段及其后续阶段需要重新计算。缓存受内存上限约束，按LRU淘汰；
+// 每个阶段另外最多保留kVariantsPerStage个结果，拖动滑块时先淘汰该阶段最久未用的结果，
+// 其缓冲区回到池中，正好给新结果使用，稳定拖动时不再分配新的缓冲区。
+// render()返回的Mat与缓存共享数据，调用方只能读取。
+class StagedPipeline {
+public:
+    enum Stage { Blur, Saturation, Contrast, Sharpen, Grayscale, Resize, StageCount };
+    static const int kVariantsPerStage = 4; // 来回拖动时最近几个取值仍可直接命中
+
+    struct Stats {
+        size_t hits = 0;          // 直接复用缓存的渲染次数
+        size_t stagesComputed = 0;
+        size_t evictions = 0;
+        int lastFirstStage = 0;   // 最近一次渲染从哪个阶段开始重新计算，StageCount表示完全命中
+    };
+
+    explicit StagedPipeline(size_t memoryBudget = 512u << 20);
+
+    void setSource(const cv::Mat& image);
+    const cv::Mat& source() const { return source_; }
+    // cancelled在每个阶段开始前检查，返回true时放弃本次渲染并返回空Mat（已算完的阶段仍会缓存）
+    cv::Mat render(const PipelineParams& params, const std::function<bool()>& cancelled = nullptr);
+
+    void clear();
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const { return budget_; }
+    size_t memoryUsage() const { return usage_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    // 阶段参数前缀：blur, blur方法, saturation, contrast, sharpen, grayscale, resize宽, resize高
+    using StageKey = std::array<int, 8>;
+
+    struct Entry {
+        cv::Mat image;
+        size_t bytes = 0;
+        int stage = 0;
+        std::list<StageKey>::iterator lru;
+    };
+
+    static StageKey keyForStage(const PipelineParams& params, int stage);
+    static void runStage(int stage, const cv::Mat& src, cv::Mat& dst, const PipelineParams& params);
+    void insert(const StageKey& key, const cv::Mat& image, int stage);
+    void evictStageVariants(int stage, int keep);
+    void evictToBudget();
+
+    cv::Mat source_;
+    size_t budget_;
+    size_t usage_ = 0;
+    std::map<StageKey, Entry> entries_;
+    std::list<StageKey> lru_; // 头部为最近使用
+    Stats stats_;
+};
+
+#endif // STAGED_PIPELINE_H
@@ -0,0 +1,29 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <cstddef>
+#include <string>
+#include "pipeline.h"
+
+// 流式处理：按水平条带读取、处理并写出，峰值内存由memoryBudget而不是图像尺寸决定
+struct StreamingOptions {
+    size_t memoryBudget = 256u << 20; // 条带缓冲区（含处理中间结果）的内存上限
+};
+
+struct StreamingStats {
+    int strips = 0;
+    int stripRows = 0;      // 每个条带的有效输出行数（不含上下的halo行）
+    int haloRows = 0;
+    size_t peakBytes = 0;   // 条带缓冲区的峰值估计
+    bool bounded = true;    // 读取或写出退回整幅处理时为false
+    double seconds = 0;
+};
+
+// 与 writeImage(output, applyPipeline(readImage(input), params)) 的结果一致；
+// 只有启用resize时，纵向插值在条带间单独完成，个别像素可能与cv::resize相差1
+bool processImageStreaming(const std::string& input, const std::string& output,
+                           const PipelineParams& params,
+                           const StreamingOptions& options = StreamingOptions(),
+                           StreamingStats* stats = nullptr);
+
+#endif // STREAMING_H
@@ -0,0 +1,70 @@
+#ifndef STRIP_IO_H
+#define STRIP_IO_H
+
+#include <opencv2/opencv.hpp>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pnm_reader.h"
+
+// 按水平条带顺序读取图像，每次输出若干行8位像素（与readImage的结果一致：灰度为单通道，其余为BGR）
+class StripReader {
+public:
+    virtual ~StripReader() = default;
+
+    virtual cv::Size size() const = 0;
+    virtual int channels() const { return 3; }
+    // 读取接下来的rows.rows行到rows（调用方按CV_8UC(channels())、宽度为size().width分配好）
+    virtual bool read(cv::Mat& rows) = 0;
+    // 是否真正按条带读取；为false时整幅图像已在内存中，内存上限无法保证
+    virtual bool streaming() const { return true; }
+};
+
+// 按水平条带顺序写出图像，begin之后按从上到下的顺序多次调用write（每行channels个通道的8位像素）
+class StripWriter {
+public:
+    virtual ~StripWriter() = default;
+
+    virtual bool begin(const std::string& path, cv::Size size, int channels) = 0;
+    virtual bool write(const cv::Mat& rows) = 0;
+    virtual bool finish() = 0;
+    virtual bool streaming() const { return true; }
+};
+
+// 根据扩展名创建读取/写出器：PPM/PGM/PNM与PNG（需libpng）支持真正的流式处理，
+// 其他格式退回整幅解码/编码。失败时返回nullptr。
+std::unique_ptr<StripReader> openStripReader(const std::string& path);
+std::unique_ptr<StripWriter> createStripWriter(const std::string& path);
+
+// 映射文件逐行解码PNM（P2/P3/P5/P6），已读过的部分及时从常驻内存中释放
+class PNMStripReader : public StripReader {
+public:
+    bool open(const std::string& path);
+    cv::Size size() const override { return cv::Size(header_.width, header_.height); }
+    int channels() const override { return header_.channels; }
+    bool read(cv::Mat& rows) override;
+
+private:
+    MappedFile file_;
+    PNMHeader header_;
+    size_t pos_ = 0;
+    size_t discarded_ = 0;
+};
+
+// 写出8位P6：每行单独做BGR->RGB交换，不生成整幅RGB副本；单通道写出P5，按行直接写
+class PPMStripWriter : public StripWriter {
+public:
+    bool begin(const std::string& path, cv::Size size, int channels) override;
+    bool write(const cv::Mat& rows) override;
+    bool finish() override;
+
+private:
+    std::ofstream file_;
+    std::vector<unsigned char> row_;
+    cv::Size size_;
+    int channels_ = 3;
+    int written_ = 0;
+};
+
+#endif // STRIP_IO_H
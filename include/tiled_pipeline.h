@@ -0,0 +1,45 @@
+#ifndef TILED_PIPELINE_H
+#define TILED_PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include "pipeline.h"
+#include "work_stealing_pool.h"
+
+// 分块执行处理链：把图像切成带halo（pipelineHaloRows）的小块，每块在一个线程上连续执行
+// 模糊 -> 颜色 -> 锐化 -> 灰度，中间结果只有一块大小，始终留在L2缓存中；
+// 各块由工作窃取线程池分配，阶段之间没有整图的同步点，也不会把中间结果写回内存再读出。
+// 每块先复制为独立的Mat，图像边缘处按整图的边界方式取值，内部边缘由halo覆盖。与applyPipeline的差别：
+//   Exact模糊及其后的逐像素阶段与锐化：逐位一致（两者走同一条融合/逐阶段路径，逐像素的运算与起点无关）；
+//   Box模糊：滑动和的单精度累加在每块（含halo）的边缘重新开始，舍入不同，模糊结果最多相差1个灰度级；
+//   Recursive模糊：在4 sigma处截断，同样最多相差1个灰度级；
+//   模糊的差异经过锐化会被放大，最多 1 + 8 * sharpen / 10 个灰度级（锐化核系数绝对值之和）。
+// 尺寸调整不是逐块运算，在拼好的整图上执行。
+// 块内各阶段以serial方式调用（见parallel_rows.h），不再嵌套parallel_for_，也不改动OpenCV的线程设置；
+// 块任务抛出的异常在所有块结束后重新抛给调用者。
+struct TileOptions {
+    int threads = 0;                  // 参与的线程数，0为cv::getNumThreads()（与OpenCV的线程设置一致）
+    size_t tileBytes = size_t(1) << 20; // 每块的工作集（输入、模糊临时缓冲与输出）目标大小，约为一个核的L2
+    WorkStealingPool* pool = nullptr; // 为空时使用sharedWorkStealingPool()
+};
+
+struct TileStats {
+    int tiles = 0;
+    int tileWidth = 0;     // 不含halo
+    int tileHeight = 0;
+    int halo = 0;
+    int threads = 0;
+    uint64_t steals = 0;   // 本次执行中被其他线程窃取的块数
+    double seconds = 0;
+};
+
+cv::Mat applyPipelineTiled(const cv::Mat& image, const PipelineParams& params,
+                           const TileOptions& options = TileOptions(), TileStats* stats = nullptr);
+
+// 只渲染region（image坐标）内的结果，不含尺寸调整：按halo多取一圈输入分块执行后再裁掉halo，
+// 与整图渲染后取同一区域的结果之间的差别同applyPipelineTiled。界面放大查看预览代理图时用它补上视口内的全分辨率细节
+cv::Mat applyPipelineRegion(const cv::Mat& image, const PipelineParams& params, const cv::Rect& region,
+                            const TileOptions& options = TileOptions());
+
+#endif // TILED_PIPELINE_H
@@ -0,0 +1,89 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 轻量的分阶段计时：TRACE_SCOPE在作用域结束时把一条事件写入全局无锁环形缓冲区，
+// 可导出为Chrome trace_event JSON（chrome://tracing 或 Perfetto 打开）。
+// 关闭时每个作用域只有一次原子读取与分支。
+struct TraceEvent {
+    const char* name = nullptr;  // 必须是字符串字面量等静态字符串
+    uint64_t startNs = 0;        // 相对进程启动
+    uint64_t durationNs = 0;
+    uint32_t threadId = 0;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    int64_t allocatedBytes = 0;  // 作用域内本线程经cv::Mat分配的字节数
+};
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool traceEnabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// 开启时安装统计分配字节数的cv::MatAllocator，关闭时恢复默认分配器
+void setTraceEnabled(bool enabled);
+
+// 写入一条事件；缓冲区满后覆盖最旧的事件
+void traceRecord(const TraceEvent& event);
+
+// 返回序号不小于cursor的所有已完成事件，并把cursor推进到最新位置（已被覆盖的事件跳过）
+std::vector<TraceEvent> traceEventsSince(uint64_t& cursor);
+
+// 把缓冲区中现有的事件写成Chrome trace_event JSON
+bool writeChromeTrace(const std::string& path);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(traceEnabled() ? name : nullptr) {
+        if (name_) {
+            begin();
+        }
+    }
+    TraceScope(const char* name, const cv::Mat& image) : TraceScope(name) {
+        setImage(image);
+    }
+    ~TraceScope() {
+        if (name_) {
+            end();
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // 记录本阶段处理的图像尺寸（例如读取完成后才知道尺寸时）
+    void setImage(const cv::Mat& image) {
+        if (name_) {
+            width_ = image.cols;
+            height_ = image.rows;
+            channels_ = image.channels();
+        }
+    }
+
+private:
+    void begin();
+    void end();
+
+    const char* name_;
+    uint64_t startNs_ = 0;
+    int64_t allocatedStart_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_IMAGE(name, image) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, image)
+
+#endif // TRACE_H
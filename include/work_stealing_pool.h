@@ -0,0 +1,75 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：run()把任务按连续区间分到各线程自己的队列，线程从自己队列的前端顺序取任务
+// （相邻任务处理相邻的数据），取完后从其他线程队列的末端窃取，负载不均时不会有线程空等。
+// 调用run()的线程也参与执行；同一时刻只执行一批任务，多个线程同时调用run()时依次执行。
+class WorkStealingPool {
+public:
+    struct Stats {
+        uint64_t runs = 0;
+        uint64_t tasks = 0;
+        uint64_t steals = 0;  // 从其他线程队列取走的任务数
+    };
+
+    // threads为0时使用硬件线程数
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // 执行task(0) .. task(count - 1)，全部完成后返回；workers限制参与的线程数（含调用线程），0为全部。
+    // 任务抛出异常时跳过尚未开始的任务，等本批的线程全部退出后在调用线程上重新抛出第一个异常
+    void run(size_t count, const std::function<void(size_t)>& task, int workers = 0);
+
+    int threadCount() const { return static_cast<int>(lanes_.size()); }
+    Stats stats() const;
+
+private:
+    struct alignas(64) Lane {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void workerMain(int lane);
+    void drain(int lane);
+    bool takeTask(int lane, size_t& task);
+
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    std::vector<std::thread> threads_;
+    std::mutex runMutex_; // 串行化run()
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;
+    int activeLanes_ = 0;
+    int busyWorkers_ = 0;  // 本批仍在执行或窃取的后台线程数
+    bool stopping_ = false;
+    const std::function<void(size_t)>* task_ = nullptr;
+    std::atomic<size_t> remaining_{0};
+    std::exception_ptr error_;       // 本批第一个任务抛出的异常，由mutex_保护
+    std::atomic<bool> failed_{false};
+
+    std::atomic<uint64_t> runs_{0};
+    std::atomic<uint64_t> tasks_{0};
+    std::atomic<uint64_t> steals_{0};
+};
+
+// 分块处理共用的线程池，线程数为硬件线程数
+WorkStealingPool& sharedWorkStealingPool();
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,559 @@
+// 无界面批处理工具：对目录或文件列表中的图像执行与GUI相同的处理链
+// 用法: ImageProcessingBatch --pipeline <spec> --output <dir> [选项] <输入目录|文件|@列表文件>...
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bounded_queue.h"
+#include "color_lut.h"
+#include "decode_cache.h"
+#include "image_utils.h"
+#include "jpeg_search.h"
+#include "pipeline.h"
+#include "sequence.h"
+#include "streaming.h"
+#include "tiled_pipeline.h"
+#include "trace.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct BatchOptions {
+    PipelineParams params;
+    std::string outputDir;
+    std::string format;   // 为空时沿用输入文件的扩展名
+    int threads = 0;
+    size_t queueSize = 0;
+    bool streaming = false;          // 逐幅按条带处理，用于超出内存的大图
+    bool tiled = false;              // 逐幅处理，每幅图像分块后由--threads个线程工作窃取执行（少量大图时比图像间并行更好）
+    size_t memoryBudget = 256u << 20;
+    std::string tracePath;           // 非空时记录各阶段耗时并导出Chrome trace JSON
+    std::string cubePath;            // 导入的.cube调色表
+    std::string exportCubePath;      // 把处理链的颜色运算（含导入的调色表）导出为.cube
+    JpegSearchOptions jpeg;          // 输出为JPEG且设置了目标大小或SSIM时，按约束搜索质量
+    bool decodeCache = true;         // 解码结果缓存到磁盘，重复处理同一批素材时跳过解码
+    std::string cacheDir;            // 为空时使用defaultDecodeCacheDirectory()
+    size_t cacheLimit = size_t(2) << 30;
+    bool sequence = false;           // 输入为帧序列或视频，按帧流水处理并保持帧顺序
+    double fps = 0;                  // 序列模式输出视频的帧率，0时沿用输入
+    std::vector<std::string> inputs;
+};
+
+struct BatchJob {
+    size_t index = 0;
+    std::string input;
+    std::string output;
+    cv::Mat image;
+    Clock::time_point start;
+};
+
+void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " --pipeline <spec> --output <dir> [--format <ext>] [--threads <n>] [--queue <n>]\n"
+              << "         [--streaming [--memory-budget <MB>] | --tiled] [--trace <file.json>]\n"
+              << "         [--cube <file.cube>] [--export-cube <file.cube>]\n"
+              << "         [--jpeg-max-kb <KB>] [--jpeg-min-ssim <0..1>] [--jpeg-progressive] [--jpeg-optimize]\n"
+              << "         [--no-cache | --cache-dir <dir> --cache-limit <MB>] <input>...\n"
+              << "       " << argv0 << " --sequence [--fps <n>] --pipeline <spec> --output <dir> [--format <ext>] [--threads <n>] [--queue <n>] <input>...\n"
+              << "  <spec>   e.g. blur=3,saturation=20,contrast=-10,sharpen=5,grayscale,resize=640x480\n"
+              << "           blurmethod=exact|box|recursive selects the blur engine (box/recursive cost is independent of radius)\n"
+              << "           lut=33 bakes saturation/contrast (and --cube) into a 3D LUT with tetrahedral lookup;\n"
+              << "           grayscale still runs as its own stage after the lookup\n"
+              << "  --tiled        process one image at a time, split into cache-sized tiles run on --threads work-stealing threads\n"
+              << "  --cube         apply a .cube 3D LUT after saturation/contrast\n"
+              << "  --export-cube  write the pipeline's color operations as a .cube file (blur, sharpen and resize are not included);\n"
+              << "                 --output and inputs are optional in this case\n"
+              << "  --jpeg-*       for .jpg outputs, search the quality for the highest quality that fits in <KB> or the\n"
+              << "                 smallest file with luma SSIM >= the target; images are searched in parallel, each one\n"
+              << "                 by plain binary search (not available with --streaming)\n"
+              << "  --cache-*      decoded pixels are cached on disk (default " << defaultDecodeCacheDirectory() << ", 2048 MB)\n"
+              << "  --sequence     each <input> is a numbered frame pattern (frames/img_%04d.ppm), a directory of frames, or a\n"
+              << "                 video file; decode, --threads workers and encode run as a pipeline that keeps frame order.\n"
+              << "                 --format picks the output (e.g. avi, mp4, or png for numbered frames); --queue is per worker\n"
+              << "  <input>  image file, directory, or @file containing one path per line; outputs are named <stem>.<format>,\n"
+              << "           so inputs sharing a stem (lena.png, lena.ppm) are rejected" << std::endl;
+}
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = lowerExtension(path.string());
+    return ext == "png" || ext == "ppm" || ext == "pgm" || ext == "jpg" || ext == "jpeg" || ext == "rle";
+}
+
+bool collectInputs(const std::string& arg, std::vector<std::string>& inputs) {
+    if (!arg.empty() && arg[0] == '@') {
+        std::ifstream list(arg.substr(1));
+        if (!list) {
+            std::cerr << "无法打开文件列表: " << arg.substr(1) << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty()) {
+                inputs.push_back(line);
+            }
+        }
+        return true;
+    }
+
+    std::error_code ec;
+    if (fs::is_directory(arg, ec)) {
+        std::vector<std::string> files;
+        for (const auto& entry : fs::directory_iterator(arg, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        inputs.insert(inputs.end(), files.begin(), files.end());
+        return true;
+    }
+    inputs.push_back(arg);
+    return true;
+}
+
+bool parseArguments(int argc, char** argv, BatchOptions& options) {
+    std::string spec;
+    std::vector<std::string> inputArgs;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : std::string(); };
+        if (arg == "--pipeline") {
+            spec = next();
+        } else if (arg == "--output") {
+            options.outputDir = next();
+        } else if (arg == "--format") {
+            options.format = next();
+        } else if (arg == "--threads") {
+            options.threads = std::atoi(next().c_str());
+        } else if (arg == "--queue") {
+            options.queueSize = static_cast<size_t>(std::max(1, std::atoi(next().c_str())));
+        } else if (arg == "--streaming") {
+            options.streaming = true;
+        } else if (arg == "--tiled") {
+            options.tiled = true;
+        } else if (arg == "--memory-budget") {
+            options.memoryBudget = static_cast<size_t>(std::max(1, std::atoi(next().c_str()))) << 20;
+        } else if (arg == "--trace") {
+            options.tracePath = next();
+        } else if (arg == "--jpeg-max-kb") {
+            options.jpeg.maxBytes = static_cast<size_t>(std::max(0.0, std::atof(next().c_str())) * 1024);
+        } else if (arg == "--jpeg-min-ssim") {
+            options.jpeg.minSsim = std::atof(next().c_str());
+        } else if (arg == "--jpeg-progressive") {
+            options.jpeg.progressive = true;
+        } else if (arg == "--jpeg-optimize") {
+            options.jpeg.optimizeHuffman = true;
+        } else if (arg == "--no-cache") {
+            options.decodeCache = false;
+        } else if (arg == "--cache-dir") {
+            options.cacheDir = next();
+        } else if (arg == "--cache-limit") {
+            options.cacheLimit = static_cast<size_t>(std::max(1, std::atoi(next().c_str()))) << 20;
+        } else if (arg == "--cube") {
+            options.cubePath = next();
+        } else if (arg == "--export-cube") {
+            options.exportCubePath = next();
+        } else if (arg == "--sequence") {
+            options.sequence = true;
+        } else if (arg == "--fps") {
+            options.fps = std::atof(next().c_str());
+        } else if (arg == "--help" || arg == "-h") {
+            return false;
+        } else {
+            inputArgs.push_back(arg);
+        }
+    }
+    // 序列模式下目录本身就是一段帧序列，不展开为单独的图像
+    for (const auto& arg : inputArgs) {
+        if (options.sequence) {
+            options.inputs.push_back(arg);
+        } else if (!collectInputs(arg, options.inputs)) {
+            return false;
+        }
+    }
+
+    std::string error;
+    if (!parsePipelineSpec(spec, options.params, &error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    if (!options.cubePath.empty()) {
+        auto grading = std::make_shared<ColorLUT3D>();
+        if (!grading->loadCube(options.cubePath)) {
+            return false;
+        }
+        options.params.grading = grading;
+    }
+    if (options.exportCubePath.empty() && (options.outputDir.empty() || options.inputs.empty())) {
+        return false;
+    }
+    if (options.threads <= 0) {
+        options.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    if (options.queueSize == 0) {
+        options.queueSize = static_cast<size_t>(options.threads) * 2;
+    }
+    return true;
+}
+
+std::string outputPathFor(const std::string& input, const BatchOptions& options) {
+    fs::path in(input);
+    std::string ext = options.format.empty() ? in.extension().string() : "." + options.format;
+    return (fs::path(options.outputDir) / (in.stem().string() + ext)).string();
+}
+
+bool isVideoFormat(const std::string& format) {
+    std::string ext = lowercase(format);
+    return ext == "avi" || ext == "mp4" || ext == "mov" || ext == "mkv";
+}
+
+// 帧序列输出：序号格式的输入沿用文件名，目录输入以目录名编号，视频输入默认仍输出视频，
+// --format为图像格式时改为逐帧写出编号图像
+std::string sequenceOutputFor(const std::string& input, const BatchOptions& options) {
+    fs::path in(input);
+    std::error_code ec;
+    std::string name;
+    if (isFrameIndexPattern(input)) {
+        name = in.stem().string() + (options.format.empty() ? in.extension().string() : "." + options.format);
+    } else if (fs::is_directory(in, ec)) {
+        std::string dir = in.filename().empty() ? in.parent_path().filename().string() : in.filename().string();
+        name = dir + "_%05d." + (options.format.empty() ? std::string("png") : options.format);
+    } else if (options.format.empty() || isVideoFormat(options.format)) {
+        name = in.stem().string() + (options.format.empty() ? in.extension().string() : "." + options.format);
+    } else {
+        name = in.stem().string() + "_%05d." + options.format;
+    }
+    return (fs::path(options.outputDir) / name).string();
+}
+
+// 输出名只取输入的文件名主干，lena.png与lena.ppm会映射到同一个输出并被并发写入，提前检出并拒绝
+bool checkOutputCollisions(const BatchOptions& options) {
+    std::unordered_map<std::string, std::string> owners;
+    bool unique = true;
+    for (const auto& input : options.inputs) {
+        std::string output = options.sequence ? sequenceOutputFor(input, options) : outputPathFor(input, options);
+        auto inserted = owners.emplace(fs::path(output).lexically_normal().string(), input);
+        if (!inserted.second) {
+            std::cerr << "Inputs " << inserted.first->second << " and " << input << " would both be written to " << output << std::endl;
+            unique = false;
+        }
+    }
+    return unique;
+}
+
+// 启动一个处理阶段的若干工作线程；最后一个退出的线程负责关闭下游队列
+template <typename Body>
+void startStage(std::vector<std::thread>& threads, int workers, BoundedQueue<BatchJob>* downstream, Body body) {
+    auto remaining = std::make_shared<std::atomic<int>>(workers);
+    for (int i = 0; i < workers; ++i) {
+        threads.emplace_back([=]() {
+            body();
+            if (remaining->fetch_sub(1) == 1 && downstream) {
+                downstream->close();
+            }
+        });
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+bool isJpegPath(const std::string& path) {
+    std::string ext = lowerExtension(path);
+    return ext == "jpg" || ext == "jpeg";
+}
+
+bool usesJpegSearch(const BatchOptions& options) {
+    const JpegSearchOptions& jpeg = options.jpeg;
+    return jpeg.maxBytes > 0 || jpeg.minSsim > 0 || jpeg.progressive || jpeg.optimizeHuffman;
+}
+
+struct JpegTotals {
+    std::atomic<int> images{0};
+    std::atomic<int> encodes{0};
+    std::atomic<int> unsatisfied{0};
+    std::atomic<int64_t> micros{0};
+};
+
+// JPEG输出按约束搜索质量后直接写出编码结果，其他格式仍走writeImage
+bool writeOutput(const std::string& path, const cv::Mat& image, const BatchOptions& options, JpegTotals& totals) {
+    if (!usesJpegSearch(options) || !isJpegPath(path)) {
+        return writeImage(path, image);
+    }
+    JpegSearchResult result = searchJpegQuality(image, options.jpeg);
+    if (result.data.empty()) {
+        return false;
+    }
+    ++totals.images;
+    totals.encodes += result.encodes;
+    totals.micros += static_cast<int64_t>(result.seconds * 1e6);
+    if (!result.satisfied) {
+        ++totals.unsatisfied;
+        std::cerr << "No JPEG quality meets the target for " << path << ", wrote quality " << result.quality << std::endl;
+    }
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(result.data.data()), static_cast<std::streamsize>(result.data.size()));
+    return static_cast<bool>(out);
+}
+
+// 颜色运算全部是逐像素的，可以完整表示为3D LUT，供其他调色软件使用
+bool exportCube(const BatchOptions& options) {
+    const PipelineParams& params = options.params;
+    ColorOps ops;
+    ops.saturation = params.saturation;
+    ops.contrast = params.contrast;
+    ops.grayscale = params.grayscale;
+    int size = params.lutSize > 0 ? params.lutSize : ColorLUT3D::kDefaultSize;
+    std::shared_ptr<const ColorLUT3D> lut = compileColorLUT(ops, size, params.grading);
+    if (lut->empty() || !lut->saveCube(options.exportCubePath, formatPipelineSpec(params))) {
+        return false;
+    }
+    std::cout << "Exported " << size << "^3 LUT: " << options.exportCubePath << std::endl;
+    return true;
+}
+
+// 流式模式：逐幅处理，每幅图像内部按条带读取、处理、写出，峰值内存受memoryBudget约束
+int runStreaming(const BatchOptions& options) {
+    StreamingOptions streamingOptions;
+    streamingOptions.memoryBudget = options.memoryBudget;
+
+    int failures = 0;
+    Clock::time_point batchStart = Clock::now();
+    for (const auto& input : options.inputs) {
+        StreamingStats stats;
+        std::string output = outputPathFor(input, options);
+        if (!processImageStreaming(input, output, options.params, streamingOptions, &stats)) {
+            std::cerr << "Failed to process image: " << input << std::endl;
+            ++failures;
+            continue;
+        }
+        std::cout << input << ": " << stats.strips << " strips of " << stats.stripRows << " rows (halo " << stats.haloRows
+                  << "), peak buffers " << (stats.peakBytes >> 20) << " MB, " << stats.seconds << " s"
+                  << (stats.bounded ? "" : " [format not streamable, decoded whole image]") << std::endl;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+    std::cout << "Pipeline: " << formatPipelineSpec(options.params) << (options.cubePath.empty() ? "" : " + " + options.cubePath) << "\n"
+              << "Streaming, memory budget: " << (options.memoryBudget >> 20) << " MB\n"
+              << "Processed: " << options.inputs.size() - failures << "/" << options.inputs.size() << " images in " << seconds << " s" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
+
+// 序列模式：逐段处理，每段内部解码、处理、编码流水并行，输出帧顺序与输入一致
+int runSequences(const BatchOptions& options) {
+    SequenceOptions sequenceOptions;
+    // 解码与编码各占一个线程，--threads只决定处理线程数；--queue为每个处理线程的队列深度
+    sequenceOptions.workers = std::max(1, options.threads - 2);
+    sequenceOptions.queueDepth = std::max<size_t>(2, options.queueSize / static_cast<size_t>(sequenceOptions.workers));
+    sequenceOptions.fps = options.fps;
+
+    int failures = 0;
+    for (const auto& input : options.inputs) {
+        SequenceStats stats;
+        std::string output = sequenceOutputFor(input, options);
+        if (!processSequence(input, output, options.params, sequenceOptions, &stats)) {
+            std::cerr << "Failed to process sequence: " << input << std::endl;
+            ++failures;
+            continue;
+        }
+        std::cout << input << " -> " << output << ": " << stats.frames << " frames in " << stats.seconds << " s, "
+                  << stats.fps() << " fps sustained\n"
+                  << "  " << stats.workers << " workers, queue depth " << sequenceOptions.queueDepth << "; decode "
+                  << stats.decodeSeconds << " s, process " << stats.processSeconds << " s (all workers), encode "
+                  << stats.encodeSeconds << " s\n"
+                  << "  decode stalled " << stats.decodeStallSeconds << " s, encode waited " << stats.encodeWaitSeconds
+                  << " s; queue occupancy decode->process " << stats.inputOccupancy * 100 << "%, process->encode "
+                  << stats.outputOccupancy * 100 << "%" << std::endl;
+    }
+    std::cout << "Pipeline: " << formatPipelineSpec(options.params) << (options.cubePath.empty() ? "" : " + " + options.cubePath) << "\n"
+              << "Processed: " << options.inputs.size() - failures << "/" << options.inputs.size() << " sequences" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    if (!options.exportCubePath.empty()) {
+        if (!exportCube(options)) {
+            return 1;
+        }
+        if (options.inputs.empty()) {
+            return 0;
+        }
+        if (options.outputDir.empty()) {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!checkOutputCollisions(options)) {
+        return 2;
+    }
+
+    std::error_code ec;
+    fs::create_directories(options.outputDir, ec);
+
+    if (!options.tracePath.empty()) {
+        setTraceEnabled(true);
+    }
+    if (options.streaming) {
+        if (usesJpegSearch(options)) {
+            std::cerr << "JPEG quality search is not available in streaming mode, ignoring --jpeg-* options" << std::endl;
+        }
+        int status = runStreaming(options);
+        if (!options.tracePath.empty()) {
+            writeChromeTrace(options.tracePath);
+        }
+        return status;
+    }
+    if (options.sequence) {
+        if (usesJpegSearch(options)) {
+            std::cerr << "JPEG quality search is not available in sequence mode, ignoring --jpeg-* options" << std::endl;
+        }
+        cv::setNumThreads(1); // 帧间已经并行
+        int status = runSequences(options);
+        if (!options.tracePath.empty()) {
+            writeChromeTrace(options.tracePath);
+        }
+        return status;
+    }
+
+    // 并行度来自图像间并行，避免OpenCV内部再开线程造成过度订阅（结果与线程数无关）
+    cv::setNumThreads(1);
+    // 同理，JPEG质量搜索每轮只试一个质量，即普通二分搜索，不依赖上面的线程数设置
+    options.jpeg.parallelism = 1;
+
+    const int ioWorkers = std::max(1, options.threads / 2);
+    BoundedQueue<BatchJob> decodeQueue(options.queueSize);
+    BoundedQueue<BatchJob> processQueue(options.queueSize);
+    BoundedQueue<BatchJob> encodeQueue(options.queueSize);
+
+    std::vector<double> latencies(options.inputs.size(), -1.0);
+    std::atomic<int> failures{0};
+    JpegTotals jpegTotals;
+    std::unique_ptr<DecodeCache> cache;
+    if (options.decodeCache) {
+        cache.reset(new DecodeCache(options.cacheDir.empty() ? defaultDecodeCacheDirectory() : options.cacheDir, options.cacheLimit));
+    }
+    std::vector<std::thread> threads;
+
+    // 解码 -> 处理 -> 编码，队列有界，内存占用不随输入数量增长
+    startStage(threads, ioWorkers, &processQueue, [&]() {
+        BatchJob job;
+        while (decodeQueue.pop(job)) {
+            job.start = Clock::now();
+            job.image = cache ? cache->load(job.input) : readImage(job.input);
+            if (job.image.empty()) {
+                std::cerr << "Unable to open or find image: " << job.input << std::endl;
+                ++failures;
+                continue;
+            }
+            processQueue.push(std::move(job));
+        }
+    });
+    // 分块模式下只有一个处理线程，并行度来自图像内部的块
+    TileOptions tileOptions;
+    tileOptions.threads = options.threads;
+    TileStats tileTotals;
+    startStage(threads, options.tiled ? 1 : options.threads, &encodeQueue, [&]() {
+        BatchJob job;
+        while (processQueue.pop(job)) {
+            if (options.tiled) {
+                TileStats tileStats;
+                job.image = applyPipelineTiled(job.image, options.params, tileOptions, &tileStats);
+                tileTotals.tiles += tileStats.tiles;
+                tileTotals.steals += tileStats.steals;
+                tileTotals.tileWidth = tileStats.tileWidth;
+                tileTotals.tileHeight = tileStats.tileHeight;
+                tileTotals.halo = tileStats.halo;
+                tileTotals.threads = tileStats.threads;
+            } else {
+                job.image = applyPipeline(job.image, options.params);
+            }
+            encodeQueue.push(std::move(job));
+        }
+    });
+    startStage(threads, ioWorkers, nullptr, [&]() {
+        BatchJob job;
+        while (encodeQueue.pop(job)) {
+            if (!writeOutput(job.output, job.image, options, jpegTotals)) {
+                std::cerr << "Failed to write image: " << job.output << std::endl;
+                ++failures;
+                continue;
+            }
+            latencies[job.index] = std::chrono::duration<double, std::milli>(Clock::now() - job.start).count();
+        }
+    });
+
+    Clock::time_point batchStart = Clock::now();
+    for (size_t i = 0; i < options.inputs.size(); ++i) {
+        BatchJob job;
+        job.index = i;
+        job.input = options.inputs[i];
+        job.output = outputPathFor(job.input, options);
+        decodeQueue.push(std::move(job));
+    }
+    decodeQueue.close();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+    std::vector<double> done;
+    for (double latency : latencies) {
+        if (latency >= 0) {
+            done.push_back(latency);
+        }
+    }
+    std::sort(done.begin(), done.end());
+
+    std::cout << "Pipeline: " << formatPipelineSpec(options.params) << (options.cubePath.empty() ? "" : " + " + options.cubePath) << "\n"
+              << "Threads: " << options.threads << " (decode/encode " << ioWorkers << "), queue: " << options.queueSize << "\n"
+              << "Processed: " << done.size() << "/" << options.inputs.size() << " images in " << seconds << " s\n"
+              << "Throughput: " << (seconds > 0 ? done.size() / seconds : 0) << " images/s\n"
+              << "Latency p50: " << percentile(done, 0.50) << " ms, p99: " << percentile(done, 0.99) << " ms" << std::endl;
+    if (options.tiled) {
+        std::cout << "Tiles: " << tileTotals.tiles << " of up to " << tileTotals.tileWidth << "x" << tileTotals.tileHeight << " (halo "
+                  << tileTotals.halo << ") on " << tileTotals.threads << " threads, " << tileTotals.steals << " stolen" << std::endl;
+    }
+    if (cache) {
+        DecodeCache::Stats cacheStats = cache->stats();
+        std::cout << "Decode cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, " << cacheStats.evictions
+                  << " evicted, " << (cacheStats.bytes >> 20) << " MB in " << cache->directory() << std::endl;
+    }
+    if (jpegTotals.images > 0) {
+        std::cout << "JPEG search: " << jpegTotals.images << " images, " << jpegTotals.encodes << " encodes, "
+                  << jpegTotals.micros / 1e6 << " s, " << jpegTotals.unsatisfied << " missed the target" << std::endl;
+    }
+
+    if (!options.tracePath.empty() && writeChromeTrace(options.tracePath)) {
+        std::cout << "Trace written to " << options.tracePath << std::endl;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
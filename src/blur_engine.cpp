@@ -0,0 +1,275 @@
+#include "blur_engine.h"
+#include "border_math.h"
+#include "buffer_pool.h"
+#include "parallel_rows.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const int kBoxPasses = 3;
+const int kColumnStrip = 256; // 纵向处理时每个任务负责的浮点数列数
+
+// 三次盒式滤波的宽度，使级联后的方差等于sigma²（Kovesi, "Fast Almost-Gaussian Filtering"）
+std::array<int, kBoxPasses> boxRadii(double sigma) {
+    const int n = kBoxPasses;
+    double ideal = std::sqrt(12.0 * sigma * sigma / n + 1);
+    int lower = static_cast<int>(std::floor(ideal));
+    if (lower % 2 == 0) {
+        --lower;
+    }
+    lower = std::max(lower, 1);
+    int upper = lower + 2;
+    double mIdeal = (12.0 * sigma * sigma - n * lower * lower - 4.0 * n * lower - 3.0 * n) / (-4.0 * lower - 4);
+    int m = static_cast<int>(std::lround(mIdeal));
+    std::array<int, kBoxPasses> radii;
+    for (int i = 0; i < n; ++i) {
+        radii[i] = ((i < m ? lower : upper) - 1) / 2;
+    }
+    return radii;
+}
+
+// Young & van Vliet (1995) 三阶递归高斯的系数（已除以b0），递推式为
+// w[n] = B*x[n] + a1*w[n-1] + a2*w[n-2] + a3*w[n-3]
+struct RecursiveCoefficients {
+    float B;
+    float a1, a2, a3;
+
+    explicit RecursiveCoefficients(double sigma) {
+        double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1 - 0.26891 * sigma);
+        double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+        double b1 = 2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q;
+        double b2 = -(1.4281 * q * q + 1.26661 * q * q * q);
+        double b3 = 0.422205 * q * q * q;
+        a1 = static_cast<float>(b1 / b0);
+        a2 = static_cast<float>(b2 / b0);
+        a3 = static_cast<float>(b3 / b0);
+        B = 1.0f - (a1 + a2 + a3);
+    }
+};
+
+// 纵向滑动和的一行：out = sum * scale，然后 sum += add - sub
+inline void boxColumnStep(float* sum, float* out, const float* add, const float* sub, int n, float scale) {
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    const cv::v_float32 vscale = cv::vx_setall_f32(scale);
+    for (; x <= n - lanes; x += lanes) {
+        const cv::v_float32 v = cv::vx_load(sum + x);
+        cv::v_store(out + x, cv::v_mul(v, vscale));
+        cv::v_store(sum + x, cv::v_add(v, cv::v_sub(cv::vx_load(add + x), cv::vx_load(sub + x))));
+    }
+#endif
+    for (; x < n; ++x) {
+        out[x] = sum[x] * scale;
+        sum[x] += add[x] - sub[x];
+    }
+}
+
+// 纵向盒式滤波：以整行为向量维护滑动和，内层循环沿连续内存按SIMD宽度处理；按列条带并行
+void boxColumns(const cv::Mat& src, cv::Mat& dst, int radius, bool serial) {
+    const int rows = src.rows;
+    const int cols = src.cols;
+    const float scale = 1.0f / (2 * radius + 1);
+    const int strips = (cols + kColumnStrip - 1) / kColumnStrip;
+    parallelRows(cv::Range(0, strips), [&](const cv::Range& range) {
+        std::vector<float> sum(kColumnStrip);
+        for (int strip = range.start; strip < range.end; ++strip) {
+            const int x0 = strip * kColumnStrip;
+            const int n = std::min(kColumnStrip, cols - x0);
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            for (int k = -radius; k <= radius; ++k) {
+                const float* in = src.ptr<float>(reflect101(k, rows)) + x0;
+                for (int x = 0; x < n; ++x) {
+                    sum[x] += in[x];
+                }
+            }
+            for (int y = 0; y < rows; ++y) {
+                boxColumnStep(sum.data(), dst.ptr<float>(y) + x0, src.ptr<float>(reflect101(y + radius + 1, rows)) + x0,
+                              src.ptr<float>(reflect101(y - radius, rows)) + x0, n, scale);
+            }
+        }
+    }, serial);
+}
+
+// 递归高斯的一行递推（原地）：v = B*v + a1*w1 + a2*w2 + a3*w3，w1~w3为递推方向上的前三行
+inline void recursiveStep(float* v, const float* w1, const float* w2, const float* w3, int n, const RecursiveCoefficients& k) {
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    const cv::v_float32 b = cv::vx_setall_f32(k.B);
+    const cv::v_float32 a1 = cv::vx_setall_f32(k.a1);
+    const cv::v_float32 a2 = cv::vx_setall_f32(k.a2);
+    const cv::v_float32 a3 = cv::vx_setall_f32(k.a3);
+    for (; x <= n - lanes; x += lanes) {
+        cv::v_float32 r = cv::v_mul(b, cv::vx_load(v + x));
+        r = cv::v_add(r, cv::v_mul(a1, cv::vx_load(w1 + x)));
+        r = cv::v_add(r, cv::v_mul(a2, cv::vx_load(w2 + x)));
+        r = cv::v_add(r, cv::v_mul(a3, cv::vx_load(w3 + x)));
+        cv::v_store(v + x, r);
+    }
+#endif
+    for (; x < n; ++x) {
+        v[x] = k.B * v[x] + k.a1 * w1[x] + k.a2 * w2[x] + k.a3 * w3[x];
+    }
+}
+
+// 纵向递归高斯（原地）：前向与后向各一次三阶递推，边界按稳态（重复边缘值）初始化；
+// 递推状态就是前几行，直接引用已算出的行，内层循环沿连续内存按SIMD宽度处理
+void recursiveColumns(cv::Mat& image, const RecursiveCoefficients& k, bool serial) {
+    const int rows = image.rows;
+    const int cols = image.cols;
+    const int strips = (cols + kColumnStrip - 1) / kColumnStrip;
+    parallelRows(cv::Range(0, strips), [&](const cv::Range& range) {
+        std::vector<float> edge(kColumnStrip);
+        for (int strip = range.start; strip < range.end; ++strip) {
+            const int x0 = strip * kColumnStrip;
+            const int n = std::min(kColumnStrip, cols - x0);
+            auto rowAt = [&](int y) { return image.ptr<float>(y) + x0; };
+
+            std::copy(rowAt(0), rowAt(0) + n, edge.begin());
+            for (int y = 0; y < rows; ++y) {
+                float* v = rowAt(y);
+                const float* w1 = y >= 1 ? rowAt(y - 1) : edge.data();
+                const float* w2 = y >= 2 ? rowAt(y - 2) : edge.data();
+                const float* w3 = y >= 3 ? rowAt(y - 3) : edge.data();
+                recursiveStep(v, w1, w2, w3, n, k);
+            }
+
+            std::copy(rowAt(rows - 1), rowAt(rows - 1) + n, edge.begin());
+            for (int y = rows - 1; y >= 0; --y) {
+                float* v = rowAt(y);
+                const float* w1 = y + 1 < rows ? rowAt(y + 1) : edge.data();
+                const float* w2 = y + 2 < rows ? rowAt(y + 2) : edge.data();
+                const float* w3 = y + 3 < rows ? rowAt(y + 3) : edge.data();
+                recursiveStep(v, w1, w2, w3, n, k);
+            }
+        }
+    }, serial);
+}
+
+// from为 rows x (cols*channels) 的平铺矩阵（各通道交错），转置后写入storage的内存，返回 cols x (rows*channels) 的平铺视图。
+// 横向滤波先转置成纵向，再用同一个按整行向量化的纵向实现处理
+cv::Mat transposeFlat(const cv::Mat& from, const cv::Mat& storage, int channels) {
+    cv::Mat view = storage.reshape(channels, from.cols / channels);
+    cv::transpose(from.reshape(channels), view);
+    return view.reshape(1);
+}
+
+} // namespace
+
+const char* blurMethodName(BlurMethod method) {
+    switch (method) {
+    case BlurMethod::Box: return "box";
+    case BlurMethod::Recursive: return "recursive";
+    default: return "exact";
+    }
+}
+
+bool parseBlurMethod(const std::string& name, BlurMethod& method) {
+    if (name == "exact") {
+        method = BlurMethod::Exact;
+    } else if (name == "box") {
+        method = BlurMethod::Box;
+    } else if (name == "recursive" || name == "iir") {
+        method = BlurMethod::Recursive;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+double gaussianSigmaForKernel(int kernelSize) {
+    return 0.3 * ((kernelSize - 1) * 0.5 - 1) + 0.8;
+}
+
+int blurSupportRadius(double sigma, BlurMethod method) {
+    if (sigma <= 0) {
+        return 0;
+    }
+    switch (method) {
+    case BlurMethod::Box: {
+        std::array<int, kBoxPasses> radii = boxRadii(sigma);
+        return radii[0] + radii[1] + radii[2];
+    }
+    case BlurMethod::Recursive:
+        return static_cast<int>(std::ceil(4 * sigma));
+    default:
+        return static_cast<int>(std::ceil(3 * sigma));
+    }
+}
+
+void fastGaussianBlur(const cv::Mat& src, cv::Mat& dst, double sigma, BlurMethod method, bool serial) {
+    if (sigma <= 0 || src.empty()) {
+        src.copyTo(dst);
+        return;
+    }
+    if (method == BlurMethod::Exact || src.depth() != CV_8U || src.channels() > 4) {
+        int radius = blurSupportRadius(sigma, BlurMethod::Exact);
+        cv::GaussianBlur(src, dst, cv::Size(2 * radius + 1, 2 * radius + 1), sigma);
+        return;
+    }
+
+    // 在浮点缓冲区上滤波，各通道交错存放，视为 rows x (cols*channels) 的单通道矩阵。
+    // 两个方向都用纵向实现：先纵向滤波，转置后再纵向滤波（即原图的横向），最后转置回来；
+    // 各次盒式滤波是不同方向上的线性运算，可以交换顺序，因此三次纵向之后再做三次横向，只需转置两次。
+    // 缓冲区从池中借用，反复拖动滑块时不再重新分配
+    const int channels = src.channels();
+    const int width = src.cols;
+    BufferPool& pool = sharedBufferPool();
+    cv::Mat result;
+
+    if (method == BlurMethod::Box) {
+        cv::Mat first = pool.acquire(src.rows, width * channels, CV_32F);
+        cv::Mat second = pool.acquire(src.rows, width * channels, CV_32F);
+        src.reshape(1).convertTo(first, CV_32F);
+        const std::array<int, kBoxPasses> radii = boxRadii(sigma);
+        // 两块缓冲区交替作为输入与输出，转置后的视图仍落在这两块内存上
+        auto boxPasses = [&](cv::Mat& in, cv::Mat& out) {
+            for (int radius : radii) {
+                if (radius > 0) {
+                    boxColumns(in, out, radius, serial);
+                    std::swap(in, out);
+                }
+            }
+        };
+        cv::Mat in = first;
+        cv::Mat out = second;
+        boxPasses(in, out);
+        cv::Mat inT = transposeFlat(in, out, channels);
+        cv::Mat outT = in.reshape(1, width);
+        boxPasses(inT, outT);
+        result = transposeFlat(inT, outT.data == first.data ? first : second, channels);
+        pool.recycle(result.data == first.data ? second : first);
+    } else {
+        // 递归滤波的边界初始化相当于重复边缘，先按REFLECT_101补上4*sigma宽的边，滤波后再取中间部分
+        const int pad = blurSupportRadius(sigma, BlurMethod::Recursive);
+        cv::Mat padded = pool.acquire(src.rows + 2 * pad, (width + 2 * pad) * channels, CV_32F);
+        parallelRows(cv::Range(0, padded.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; ++y) {
+                const uchar* in = src.ptr<uchar>(reflect101(y - pad, src.rows));
+                float* out = padded.ptr<float>(y);
+                for (int x = -pad; x < width + pad; ++x) {
+                    const uchar* p = in + reflect101(x, width) * channels;
+                    std::copy(p, p + channels, out + (x + pad) * channels);
+                }
+            }
+        }, serial);
+        RecursiveCoefficients k(sigma);
+        recursiveColumns(padded, k, serial);
+        cv::Mat transposed = transposeFlat(padded, pool.acquire(padded.rows, padded.cols, CV_32F), channels);
+        recursiveColumns(transposed, k, serial);
+        transposeFlat(transposed, padded, channels);
+        pool.recycle(transposed);
+        result = padded(cv::Rect(pad * channels, pad, width * channels, src.rows));
+    }
+
+    // dst已是正确的尺寸与类型时（包括原地调用）直接写入
+    dst.create(src.size(), src.type());
+    cv::Mat flat = dst.reshape(1);
+    result.convertTo(flat, CV_8U);
+    pool.recycle(result);
+}
@@ -0,0 +1,94 @@
+#include "buffer_pool.h"
+#include <algorithm>
+
+namespace {
+
+// 只有池自己持有引用时缓冲区才算空闲
+bool isIdle(const cv::Mat& buffer) {
+    return buffer.u && buffer.u->refcount == 1;
+}
+
+size_t bytesOf(const cv::Mat& buffer) {
+    return buffer.total() * buffer.elemSize();
+}
+
+} // namespace
+
+BufferPool::BufferPool(size_t idleBudget) : idleBudget_(idleBudget) {}
+
+cv::Mat BufferPool::acquire(int rows, int cols, int type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.acquires;
+    for (Slot& slot : slots_) {
+        if (slot.buffer.rows == rows && slot.buffer.cols == cols && slot.buffer.type() == type && isIdle(slot.buffer)) {
+            ++stats_.reuses;
+            slot.lastUse = ++clock_;
+            return slot.buffer; // 在锁内复制，引用计数随即变为2，其他线程不会再把它当作空闲
+        }
+    }
+
+    Slot slot;
+    slot.buffer.create(rows, cols, type);
+    slot.lastUse = ++clock_;
+    ++stats_.allocations;
+    stats_.allocatedBytes += bytesOf(slot.buffer);
+    slots_.push_back(slot);
+    trimLocked(idleBudget_);
+    return slot.buffer;
+}
+
+void BufferPool::recycle(cv::Mat& buffer) {
+    buffer.release();
+    std::lock_guard<std::mutex> lock(mutex_);
+    trimLocked(idleBudget_);
+}
+
+void BufferPool::setIdleBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idleBudget_ = bytes;
+    trimLocked(idleBudget_);
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trimLocked(0);
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    for (const Slot& slot : slots_) {
+        stats.pooledBytes += bytesOf(slot.buffer);
+        if (isIdle(slot.buffer)) {
+            stats.idleBytes += bytesOf(slot.buffer);
+        }
+    }
+    return stats;
+}
+
+void BufferPool::trimLocked(size_t idleLimit) {
+    size_t idleBytes = 0;
+    for (const Slot& slot : slots_) {
+        if (isIdle(slot.buffer)) {
+            idleBytes += bytesOf(slot.buffer);
+        }
+    }
+    if (idleBytes <= idleLimit) {
+        return;
+    }
+    // 按最近使用时间从旧到新释放空闲缓冲区，直到不超过上限
+    std::stable_sort(slots_.begin(), slots_.end(), [](const Slot& a, const Slot& b) { return a.lastUse < b.lastUse; });
+    for (auto it = slots_.begin(); it != slots_.end() && idleBytes > idleLimit;) {
+        if (isIdle(it->buffer)) {
+            idleBytes -= bytesOf(it->buffer);
+            it = slots_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+BufferPool& sharedBufferPool() {
+    static BufferPool pool;
+    return pool;
+}
@@ -0,0 +1,412 @@
+#include "color_kernels.h"
+#include "color_math.h"
+#include "parallel_rows.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define COLOR_KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define COLOR_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// ---- 对比度：dst = saturate(src * alpha)，与convertTo的单精度计算一致 ----
+
+using ScaleRowFn = void (*)(const uchar*, uchar*, int, float);
+
+void scaleRowScalar(const uchar* src, uchar* dst, int n, float alpha) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = cv::saturate_cast<uchar>(src[i] * alpha);
+    }
+}
+
+#ifdef COLOR_KERNELS_X86
+__attribute__((target("avx2")))
+void scaleRowAvx2(const uchar* src, uchar* dst, int n, float alpha) {
+    const __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_cvtepu8_epi32(bytes);
+        __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+        __m256i rlo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), va));
+        __m256i rhi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), va));
+        // packs按128位通道交错，需要重新排列成顺序
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(rlo, rhi), 0xD8);
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    scaleRowScalar(src + i, dst + i, n - i, alpha);
+}
+
+__attribute__((target("sse4.1")))
+void scaleRowSse41(const uchar* src, uchar* dst, int n, float alpha) {
+    const __m128 va = _mm_set1_ps(alpha);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i r0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes)), va));
+        __m128i r1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4))), va));
+        __m128i r2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8))), va));
+        __m128i r3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12))), va));
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    scaleRowScalar(src + i, dst + i, n - i, alpha);
+}
+#endif
+
+#ifdef COLOR_KERNELS_NEON
+void scaleRowNeon(const uchar* src, uchar* dst, int n, float alpha) {
+    const float32x4_t va = vdupq_n_f32(alpha);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t bytes = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+        uint16x8_t hi = vmovl_high_u8(bytes);
+        int32x4_t r0 = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), va));
+        int32x4_t r1 = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_high_u16(lo)), va));
+        int32x4_t r2 = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), va));
+        int32x4_t r3 = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_high_u16(hi)), va));
+        int16x8_t w0 = vcombine_s16(vqmovn_s32(r0), vqmovn_s32(r1));
+        int16x8_t w1 = vcombine_s16(vqmovn_s32(r2), vqmovn_s32(r3));
+        vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(w0), vqmovun_s16(w1)));
+    }
+    scaleRowScalar(src + i, dst + i, n - i, alpha);
+}
+#endif
+
+// ---- 灰度：BGR -> 定点加权 -> 复制回三个通道，与BGR2GRAY + GRAY2BGR一致 ----
+// 每次先读入一整块再写出，支持原地（dst == src）
+
+using GrayRowFn = void (*)(const uchar*, uchar*, int);
+
+void grayRowScalar(const uchar* src, uchar* dst, int width) {
+    for (int x = 0; x < width; ++x, src += 3, dst += 3) {
+        uchar gray = static_cast<uchar>(bgrToGray(src[0], src[1], src[2]));
+        dst[0] = dst[1] = dst[2] = gray;
+    }
+}
+
+#ifdef COLOR_KERNELS_X86
+// 16字节中从起点开始的4个像素（12字节）的灰度，结果在各32位通道的低字节
+__attribute__((target("sse4.1")))
+inline __m128i grayQuadSse41(__m128i pixels) {
+    const __m128i pickB = _mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+    const __m128i pickG = _mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+    const __m128i pickR = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    __m128i sum = _mm_mullo_epi32(_mm_shuffle_epi8(pixels, pickB), _mm_set1_epi32(kBlueToGray));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_shuffle_epi8(pixels, pickG), _mm_set1_epi32(kGreenToGray)));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_shuffle_epi8(pixels, pickR), _mm_set1_epi32(kRedToGray)));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (kGrayShift - 1))), kGrayShift);
+}
+
+// AVX2机器同样使用这一版本：跨128位通道的三通道交错在AVX2下没有更便宜的做法
+__attribute__((target("sse4.1")))
+void grayRowSse41(const uchar* src, uchar* dst, int width) {
+    int x = 0;
+    for (; x <= width - 16; x += 16, src += 48, dst += 48) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+        // 第k组4个像素从第12k字节开始
+        __m128i g0 = grayQuadSse41(v0);
+        __m128i g1 = grayQuadSse41(_mm_alignr_epi8(v1, v0, 12));
+        __m128i g2 = grayQuadSse41(_mm_alignr_epi8(v2, v1, 8));
+        __m128i g3 = grayQuadSse41(_mm_srli_si128(v2, 4));
+        __m128i gray = _mm_packus_epi16(_mm_packus_epi32(g0, g1), _mm_packus_epi32(g2, g3));
+        const __m128i spread0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+        const __m128i spread1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+        const __m128i spread2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(gray, spread0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_shuffle_epi8(gray, spread1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_shuffle_epi8(gray, spread2));
+    }
+    grayRowScalar(src, dst, width - x);
+}
+#endif
+
+#ifdef COLOR_KERNELS_NEON
+inline uint16x4_t grayHalfNeon(uint16x4_t b, uint16x4_t g, uint16x4_t r) {
+    uint32x4_t sum = vmull_n_u16(b, kBlueToGray);
+    sum = vmlal_n_u16(sum, g, kGreenToGray);
+    sum = vmlal_n_u16(sum, r, kRedToGray);
+    return vmovn_u32(vshrq_n_u32(vaddq_u32(sum, vdupq_n_u32(1 << (kGrayShift - 1))), kGrayShift));
+}
+
+void grayRowNeon(const uchar* src, uchar* dst, int width) {
+    int x = 0;
+    for (; x <= width - 16; x += 16, src += 48, dst += 48) {
+        uint8x16x3_t bgr = vld3q_u8(src);
+        uint16x8_t b0 = vmovl_u8(vget_low_u8(bgr.val[0])), b1 = vmovl_high_u8(bgr.val[0]);
+        uint16x8_t g0 = vmovl_u8(vget_low_u8(bgr.val[1])), g1 = vmovl_high_u8(bgr.val[1]);
+        uint16x8_t r0 = vmovl_u8(vget_low_u8(bgr.val[2])), r1 = vmovl_high_u8(bgr.val[2]);
+        uint16x8_t lo = vcombine_u16(grayHalfNeon(vget_low_u16(b0), vget_low_u16(g0), vget_low_u16(r0)),
+                                     grayHalfNeon(vget_high_u16(b0), vget_high_u16(g0), vget_high_u16(r0)));
+        uint16x8_t hi = vcombine_u16(grayHalfNeon(vget_low_u16(b1), vget_low_u16(g1), vget_low_u16(r1)),
+                                     grayHalfNeon(vget_high_u16(b1), vget_high_u16(g1), vget_high_u16(r1)));
+        uint8x16_t gray = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+        uint8x16x3_t out = {{gray, gray, gray}};
+        vst3q_u8(dst, out);
+    }
+    grayRowScalar(src, dst, width - x);
+}
+#endif
+
+// 对比度与灰度的行内核按CPU在运行时选择；HSV换算没有向量化版本
+struct RowKernelDispatch {
+    ScaleRowFn scale = scaleRowScalar;
+    GrayRowFn gray = grayRowScalar;
+    const char* isa = "scalar";
+
+    RowKernelDispatch() {
+#if defined(COLOR_KERNELS_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1")) {
+            scale = scaleRowSse41;
+            gray = grayRowSse41;
+            isa = "sse4.1";
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            scale = scaleRowAvx2;
+            isa = "avx2";
+        }
+#elif defined(COLOR_KERNELS_NEON)
+        scale = scaleRowNeon;
+        gray = grayRowNeon;
+        isa = "neon";
+#endif
+    }
+};
+
+const RowKernelDispatch& rowKernelDispatch() {
+    static const RowKernelDispatch dispatch;
+    return dispatch;
+}
+
+// ---- 融合内核 ----
+
+struct FusedParams {
+    int saturation = 0;
+    bool contrast = false;
+    float alpha = 1.f;
+    uchar contrastLut[256];
+    bool grayscale = false;
+
+    explicit FusedParams(const ColorOps& ops) : saturation(ops.saturation), contrast(ops.contrast != 0), grayscale(ops.grayscale) {
+        alpha = static_cast<float>(1 + ops.contrast / 50.0);
+        for (int v = 0; v < 256; ++v) {
+            contrastLut[v] = cv::saturate_cast<uchar>(v * alpha);
+        }
+    }
+};
+
+// 每种启用组合各实例化一份，关闭的运算在编译期去掉，循环内没有分支
+template <bool Saturation, bool Contrast, bool Grayscale>
+void fusedRow(const uchar* src, uchar* dst, int width, const FusedParams& p, const HsvTables& tables) {
+    for (int x = 0; x < width; ++x, src += 3, dst += 3) {
+        int b = src[0], g = src[1], r = src[2];
+        if (Saturation) {
+            int h, s, v;
+            bgrToHsv(b, g, r, tables, h, s, v);
+            s = std::min(255, std::max(0, s + p.saturation));
+            hsvToBgr(h, s, v, b, g, r);
+        }
+        if (Contrast) {
+            b = p.contrastLut[b];
+            g = p.contrastLut[g];
+            r = p.contrastLut[r];
+        }
+        if (Grayscale) {
+            b = g = r = bgrToGray(b, g, r);
+        }
+        dst[0] = static_cast<uchar>(b);
+        dst[1] = static_cast<uchar>(g);
+        dst[2] = static_cast<uchar>(r);
+    }
+}
+
+using FusedRowFn = void (*)(const uchar*, uchar*, int, const FusedParams&, const HsvTables&);
+
+// 按 饱和度 | 对比度 << 1 | 灰度 << 2 索引
+const FusedRowFn kFusedRows[8] = {
+    fusedRow<false, false, false>, fusedRow<true, false, false>, fusedRow<false, true, false>, fusedRow<true, true, false>,
+    fusedRow<false, false, true>, fusedRow<true, false, true>, fusedRow<false, true, true>, fusedRow<true, true, true>,
+};
+
+void runFused(const cv::Mat& src, cv::Mat& dst, const ColorOps& ops, bool serial) {
+    const FusedParams params(ops);
+    const HsvTables& tables = hsvTables();
+    const RowKernelDispatch& kernels = rowKernelDispatch();
+    // 没有饱和度时对比度与灰度都走向量化行内核（灰度在对比度写出的行上原地进行，该行仍在缓存中）
+    const bool vectorRows = src.channels() == 1 || ops.saturation == 0;
+    const FusedRowFn row = kFusedRows[(params.saturation != 0) | (params.contrast << 1) | (params.grayscale << 2)];
+
+    parallelRows(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* in = src.ptr<uchar>(y);
+            uchar* out = dst.ptr<uchar>(y);
+            if (!vectorRows) {
+                row(in, out, src.cols, params, tables);
+                continue;
+            }
+            if (params.contrast) {
+                kernels.scale(in, out, src.cols * src.channels(), params.alpha);
+                in = out;
+            }
+            if (params.grayscale && src.channels() == 3) {
+                kernels.gray(in, out, src.cols);
+            }
+        }
+    }, serial);
+}
+
+// xorshift32，自检的输入固定可复现
+uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void fillRandom(cv::Mat& image, uint32_t& state) {
+    for (int y = 0; y < image.rows; ++y) {
+        uchar* row = image.ptr<uchar>(y);
+        for (int x = 0; x < image.cols * image.channels(); ++x) {
+            row[x] = static_cast<uchar>(nextRandom(state) >> 24);
+        }
+    }
+}
+
+bool fusedMatches(const cv::Mat& sample, const ColorOps& ops) {
+    cv::Mat expected = sample.clone();
+    applyColorOpsReference(expected, ops);
+    cv::Mat actual(sample.size(), sample.type());
+    runFused(sample, actual, ops, false);
+    cv::Mat inPlace = sample.clone();
+    runFused(inPlace, inPlace, ops, false);
+    return cv::norm(expected, actual, cv::NORM_INF) == 0 && cv::norm(expected, inPlace, cv::NORM_INF) == 0;
+}
+
+bool runSelfCheck() {
+    // 随机像素加上灰阶与纯色，覆盖HSV扇区边界与饱和截断
+    cv::Mat sample(64, 64, CV_8UC3);
+    uint32_t state = 2463534242u;
+    fillRandom(sample, state);
+    for (int i = 0; i < 256; ++i) {
+        uchar* px = sample.ptr<uchar>(i / 64) + (i % 64) * 3;
+        px[0] = px[1] = px[2] = static_cast<uchar>(i);
+        uchar* pure = sample.ptr<uchar>(4 + i / 64) + (i % 64) * 3;
+        pure[0] = static_cast<uchar>(i % 3 == 0 ? 255 : i);
+        pure[1] = static_cast<uchar>(i % 3 == 1 ? 255 : 0);
+        pure[2] = static_cast<uchar>(i % 3 == 2 ? 255 : 255 - i);
+    }
+
+    const ColorOps cases[] = {
+        {100, 0, false}, {-100, 0, false}, {37, 0, false}, {-1, 0, false},
+        {0, -100, false}, {0, -13, false}, {0, 41, false}, {0, 100, false},
+        {0, 0, true}, {55, -20, true}, {-70, 60, false}, {12, 7, true},
+    };
+    for (const ColorOps& ops : cases) {
+        if (!fusedMatches(sample, ops)) {
+            return false;
+        }
+    }
+
+    // 每种启用组合再取若干组随机参数与随机图像；宽度不是16的倍数，覆盖向量内核的尾部
+    cv::Mat color(29, 67, CV_8UC3);
+    cv::Mat gray(29, 67, CV_8UC1);
+    for (int mask = 1; mask < 8; ++mask) {
+        for (int trial = 0; trial < 4; ++trial) {
+            ColorOps ops;
+            if (mask & 1) {
+                ops.saturation = static_cast<int>(nextRandom(state) % 200) - 100;
+                ops.saturation += ops.saturation >= 0 ? 1 : 0; // 取[-100, 100]中的非零值
+            }
+            if (mask & 2) {
+                ops.contrast = static_cast<int>(nextRandom(state) % 200) - 100;
+                ops.contrast += ops.contrast >= 0 ? 1 : 0;
+            }
+            ops.grayscale = (mask & 4) != 0;
+            fillRandom(color, state);
+            if (!fusedMatches(color, ops)) {
+                return false;
+            }
+            if (ops.contrast != 0) {
+                fillRandom(gray, state);
+                if (!fusedMatches(gray, ColorOps{0, ops.contrast, false})) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void applyColorOpsReference(cv::Mat& image, const ColorOps& ops) {
+    // 单通道图像没有色相与饱和度，饱和度与灰度都不改变像素
+    const bool color = image.channels() == 3;
+
+    // 应用饱和度
+    if (ops.saturation != 0 && color) {
+        cv::Mat hsv;
+        cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
+        std::vector<cv::Mat> channels;
+        cv::split(hsv, channels);
+        channels[1] += ops.saturation;
+        cv::merge(channels, hsv);
+        cv::cvtColor(hsv, image, cv::COLOR_HSV2BGR);
+    }
+
+    // 应用对比度
+    if (ops.contrast != 0) {
+        image.convertTo(image, -1, 1 + ops.contrast / 50.0, 0);
+    }
+
+    // 转换为灰度图像
+    if (ops.grayscale && color) {
+        cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(image, image, cv::COLOR_GRAY2BGR); // 转换回BGR以便显示
+    }
+}
+
+bool colorKernelMatchesOpenCV() {
+    static const bool matches = runSelfCheck();
+    return matches;
+}
+
+const char* colorKernelIsa() {
+    return rowKernelDispatch().isa;
+}
+
+void applyColorOps(const cv::Mat& src, cv::Mat& dst, const ColorOps& ops, bool serial) {
+    if ((src.type() != CV_8UC3 && src.type() != CV_8UC1) || !colorKernelMatchesOpenCV()) {
+        if (dst.data != src.data) {
+            src.copyTo(dst);
+        }
+        applyColorOpsReference(dst, ops);
+        return;
+    }
+    ColorOps effective = ops;
+    if (src.channels() == 1) {
+        effective.saturation = 0; // 单通道只有对比度起作用，逐字节缩放即可
+        effective.grayscale = false;
+    }
+    if (!effective.any()) {
+        if (dst.data != src.data) {
+            src.copyTo(dst);
+        }
+        return;
+    }
+
+    dst.create(src.size(), src.type());
+    runFused(src, dst, effective, serial);
+}
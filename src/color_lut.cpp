@@ -0,0 +1,346 @@
+#include "color_lut.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include "parallel_rows.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define COLOR_LUT_SSE 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define COLOR_LUT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 8位输入值在某一轴上落在哪个格子（已乘上该轴的步长）以及格内位置
+struct AxisTable {
+    int offset[256];
+    float frac[256];
+};
+
+void buildAxis(AxisTable& axis, int size, int stride) {
+    for (int v = 0; v < 256; ++v) {
+        float pos = v * (size - 1) / 255.0f;
+        int index = std::min(static_cast<int>(pos), size - 2);
+        axis.offset[v] = index * stride;
+        axis.frac[v] = pos - index;
+    }
+}
+
+int latticeLevel(int index, int size) {
+    return cvRound(index * 255.0 / (size - 1));
+}
+
+// 四面体插值：按三个格内位置的大小顺序，从c000沿最大分量、次大分量走到c111，
+// 只用所在四面体的4个顶点（三线性需要8个）。表项为4个float，一次处理B、G、R
+inline void lookupPixel(const float* cell, const int strides[3], float fb, float fg, float fr, uchar* out) {
+    const int sb = strides[0];
+    const int sg = strides[1];
+    const int sr = strides[2];
+    int s1, s2;
+    float f1, f2, f3;
+    if (fr >= fg) {
+        if (fg >= fb) {
+            s1 = sr; s2 = sr + sg; f1 = fr; f2 = fg; f3 = fb;
+        } else if (fr >= fb) {
+            s1 = sr; s2 = sr + sb; f1 = fr; f2 = fb; f3 = fg;
+        } else {
+            s1 = sb; s2 = sb + sr; f1 = fb; f2 = fr; f3 = fg;
+        }
+    } else {
+        if (fr >= fb) {
+            s1 = sg; s2 = sg + sr; f1 = fg; f2 = fr; f3 = fb;
+        } else if (fg >= fb) {
+            s1 = sg; s2 = sg + sb; f1 = fg; f2 = fb; f3 = fr;
+        } else {
+            s1 = sb; s2 = sb + sg; f1 = fb; f2 = fg; f3 = fr;
+        }
+    }
+    const float* c0 = cell;
+    const float* c1 = cell + s1;
+    const float* c2 = cell + s2;
+    const float* c3 = cell + sb + sg + sr;
+    const float w0 = 1.0f - f1;
+    const float w1 = f1 - f2;
+    const float w2 = f2 - f3;
+    const float w3 = f3;
+
+#if defined(COLOR_LUT_SSE)
+    __m128 acc = _mm_mul_ps(_mm_set1_ps(w0), _mm_loadu_ps(c0));
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w1), _mm_loadu_ps(c1)));
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w2), _mm_loadu_ps(c2)));
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w3), _mm_loadu_ps(c3)));
+    __m128i rounded = _mm_cvtps_epi32(acc);
+    rounded = _mm_packs_epi32(rounded, rounded);
+    rounded = _mm_packus_epi16(rounded, rounded);
+    int packed = _mm_cvtsi128_si32(rounded);
+    std::memcpy(out, &packed, 3); // 只写3个字节，原地处理时不会覆盖下一个像素
+#elif defined(COLOR_LUT_NEON)
+    float32x4_t acc = vmulq_n_f32(vld1q_f32(c0), w0);
+    acc = vmlaq_n_f32(acc, vld1q_f32(c1), w1);
+    acc = vmlaq_n_f32(acc, vld1q_f32(c2), w2);
+    acc = vmlaq_n_f32(acc, vld1q_f32(c3), w3);
+    uint16x4_t narrow = vqmovun_s32(vcvtnq_s32_f32(acc));
+    uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+    out[0] = vget_lane_u8(bytes, 0);
+    out[1] = vget_lane_u8(bytes, 1);
+    out[2] = vget_lane_u8(bytes, 2);
+#else
+    for (int c = 0; c < 3; ++c) {
+        out[c] = cv::saturate_cast<uchar>(w0 * c0[c] + w1 * c1[c] + w2 * c2[c] + w3 * c3[c]);
+    }
+#endif
+}
+
+std::string trimmed(const std::string& text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+struct CompiledEntry {
+    ColorOps ops;
+    int size = 0;
+    std::shared_ptr<const ColorLUT3D> grading; // 持有引用，保证按指针比较时地址不会被复用
+    std::shared_ptr<const ColorLUT3D> lut;
+};
+
+} // namespace
+
+ColorLUT3D ColorLUT3D::bake(int size, const std::function<void(const cv::Mat&, cv::Mat&)>& transform) {
+    ColorLUT3D lut;
+    if (size < 2 || size > kMaxSize) {
+        std::cerr << "无效的LUT尺寸: " << size << std::endl;
+        return lut;
+    }
+
+    // 每行是一组(r, g)，行内b递增，与表的布局一致
+    cv::Mat lattice(size * size, size, CV_8UC3);
+    for (int r = 0; r < size; ++r) {
+        for (int g = 0; g < size; ++g) {
+            uchar* row = lattice.ptr<uchar>(r * size + g);
+            for (int b = 0; b < size; ++b) {
+                row[3 * b] = static_cast<uchar>(latticeLevel(b, size));
+                row[3 * b + 1] = static_cast<uchar>(latticeLevel(g, size));
+                row[3 * b + 2] = static_cast<uchar>(latticeLevel(r, size));
+            }
+        }
+    }
+    cv::Mat baked;
+    transform(lattice, baked);
+    if (baked.size() != lattice.size() || baked.type() != CV_8UC3) {
+        std::cerr << "LUT烘焙失败：颜色变换的输出尺寸或类型不正确" << std::endl;
+        return lut;
+    }
+
+    lut.size_ = size;
+    lut.table_.assign(static_cast<size_t>(size) * size * size * 4, 0.0f);
+    for (int y = 0; y < baked.rows; ++y) {
+        const uchar* row = baked.ptr<uchar>(y);
+        float* entry = &lut.table_[static_cast<size_t>(y) * size * 4];
+        for (int b = 0; b < size; ++b) {
+            entry[4 * b] = row[3 * b];
+            entry[4 * b + 1] = row[3 * b + 1];
+            entry[4 * b + 2] = row[3 * b + 2];
+        }
+    }
+    return lut;
+}
+
+void ColorLUT3D::apply(const cv::Mat& src, cv::Mat& dst, bool serial) const {
+    if (empty() || src.type() != CV_8UC3) {
+        if (!empty()) {
+            std::cerr << "3D LUT只支持三通道8位图像" << std::endl;
+        }
+        if (dst.data != src.data) {
+            src.copyTo(dst);
+        }
+        return;
+    }
+    dst.create(src.size(), src.type());
+
+    const int strides[3] = {4, 4 * size_, 4 * size_ * size_};
+    AxisTable axes[3];
+    for (int c = 0; c < 3; ++c) {
+        buildAxis(axes[c], size_, strides[c]);
+    }
+    const float* table = table_.data();
+
+    parallelRows(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* in = src.ptr<uchar>(y);
+            uchar* out = dst.ptr<uchar>(y);
+            for (int x = 0; x < src.cols; ++x, in += 3, out += 3) {
+                const int b = in[0];
+                const int g = in[1];
+                const int r = in[2];
+                const float* cell = table + axes[0].offset[b] + axes[1].offset[g] + axes[2].offset[r];
+                lookupPixel(cell, strides, axes[0].frac[b], axes[1].frac[g], axes[2].frac[r], out);
+            }
+        }
+    }, serial);
+}
+
+bool ColorLUT3D::loadCube(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "无法打开LUT文件: " << path << std::endl;
+        return false;
+    }
+
+    int size = 0;
+    std::vector<float> values;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line = trimmed(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        if (std::isdigit(static_cast<unsigned char>(line[0])) || line[0] == '-' || line[0] == '.' || line[0] == '+') {
+            float r, g, b;
+            if (!(fields >> r >> g >> b)) {
+                std::cerr << "LUT文件格式错误: " << path << " 第" << lineNumber << "行" << std::endl;
+                return false;
+            }
+            values.push_back(r);
+            values.push_back(g);
+            values.push_back(b);
+            continue;
+        }
+
+        std::string keyword;
+        fields >> keyword;
+        if (keyword == "LUT_3D_SIZE") {
+            fields >> size;
+        } else if (keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX") {
+            float expected = keyword == "DOMAIN_MIN" ? 0.0f : 1.0f;
+            float d[3] = {expected, expected, expected};
+            fields >> d[0] >> d[1] >> d[2];
+            if (d[0] != expected || d[1] != expected || d[2] != expected) {
+                std::cerr << "不支持定义域不是0~1的LUT: " << path << std::endl;
+                return false;
+            }
+        } else if (keyword == "LUT_1D_SIZE") {
+            std::cerr << "不支持一维LUT: " << path << std::endl;
+            return false;
+        }
+        // TITLE等其他关键字不影响查表，忽略
+    }
+
+    if (size < 2 || size > kMaxSize || values.size() != static_cast<size_t>(size) * size * size * 3) {
+        std::cerr << "LUT文件尺寸与数据不符: " << path << std::endl;
+        return false;
+    }
+
+    // .cube中r变化最快，其次g、b；表内b变化最快
+    std::vector<float> table(static_cast<size_t>(size) * size * size * 4, 0.0f);
+    size_t next = 0;
+    for (int b = 0; b < size; ++b) {
+        for (int g = 0; g < size; ++g) {
+            for (int r = 0; r < size; ++r, next += 3) {
+                float* entry = &table[((static_cast<size_t>(r) * size + g) * size + b) * 4];
+                entry[0] = values[next + 2] * 255.0f;
+                entry[1] = values[next + 1] * 255.0f;
+                entry[2] = values[next] * 255.0f;
+            }
+        }
+    }
+    size_ = size;
+    table_.swap(table);
+    return true;
+}
+
+bool ColorLUT3D::saveCube(const std::string& path, const std::string& title) const {
+    if (empty()) {
+        std::cerr << "LUT为空，无法保存: " << path << std::endl;
+        return false;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "无法写入LUT文件: " << path << std::endl;
+        return false;
+    }
+    if (!title.empty()) {
+        out << "TITLE \"" << title << "\"\n";
+    }
+    out << "LUT_3D_SIZE " << size_ << "\n"
+        << "DOMAIN_MIN 0.0 0.0 0.0\n"
+        << "DOMAIN_MAX 1.0 1.0 1.0\n"
+        << std::fixed << std::setprecision(6);
+    for (int b = 0; b < size_; ++b) {
+        for (int g = 0; g < size_; ++g) {
+            for (int r = 0; r < size_; ++r) {
+                const float* entry = &table_[((static_cast<size_t>(r) * size_ + g) * size_ + b) * 4];
+                out << entry[2] / 255.0f << " " << entry[1] / 255.0f << " " << entry[0] / 255.0f << "\n";
+            }
+        }
+    }
+    if (!out) {
+        std::cerr << "写入LUT文件失败: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const ColorLUT3D> compileColorLUT(const ColorOps& ops, int size,
+                                                  const std::shared_ptr<const ColorLUT3D>& grading) {
+    static std::mutex mutex;
+    static std::vector<CompiledEntry> cache; // 最近使用的在末尾
+    const size_t kCapacity = 4;
+
+    auto matches = [&](const CompiledEntry& entry) {
+        return entry.ops.saturation == ops.saturation && entry.ops.contrast == ops.contrast &&
+               entry.ops.grayscale == ops.grayscale && entry.size == size && entry.grading == grading;
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto hit = std::find_if(cache.begin(), cache.end(), matches);
+        if (hit != cache.end()) {
+            std::rotate(hit, hit + 1, cache.end());
+            return cache.back().lut;
+        }
+    }
+
+    // 烘焙不持锁：格点只有size³个像素，并发时重复烘焙一次也比互相等待便宜
+    auto lut = std::make_shared<ColorLUT3D>(ColorLUT3D::bake(size, [&](const cv::Mat& lattice, cv::Mat& baked) {
+        if (!grading) {
+            applyColorOps(lattice, baked, ops);
+            return;
+        }
+        // 调色表接在饱和度/对比度之后、灰度之前，与处理链中锐化后再转灰度的顺序一致
+        ColorOps tone = ops;
+        tone.grayscale = false;
+        applyColorOps(lattice, baked, tone);
+        grading->apply(baked, baked);
+        if (ops.grayscale) {
+            ColorOps gray;
+            gray.grayscale = true;
+            applyColorOps(baked, baked, gray);
+        }
+    }));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::find_if(cache.begin(), cache.end(), matches) == cache.end()) {
+        if (cache.size() >= kCapacity) {
+            cache.erase(cache.begin());
+        }
+        cache.push_back({ops, size, grading, lut});
+    }
+    return lut;
+}
@@ -0,0 +1,415 @@
+#include "decode_cache.h"
+#include "image_utils.h"
+#include "mapped_file.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[8] = {'I', 'P', 'D', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t kVersion = 2; // 解码方式变化时递增，旧缓存随之失效
+const uint64_t kDataOffset = 64;
+const char kRefMagic[8] = {'I', 'P', 'D', 'C', 'R', 'E', 'F', '1'};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint64_t contentHash;
+    uint64_t dataOffset;
+    uint64_t dataBytes;
+};
+static_assert(sizeof(CacheHeader) <= kDataOffset, "缓存文件头超出像素数据的偏移");
+
+inline uint64_t mix(uint64_t x) {
+    // splitmix64的最终混合
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// 按8字节一组的乘法哈希，吞吐量远高于解码，只用来识别内容，不要求抗碰撞攻击
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t seed) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    uint64_t h = seed ^ (size * kMul);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ mix(word)) * kMul;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return mix((h ^ mix(tail)) * kMul);
+}
+
+uint64_t hashString(const std::string& text, uint64_t seed) {
+    return hashBytes(reinterpret_cast<const unsigned char*>(text.data()), text.size(), seed);
+}
+
+std::string hexName(uint64_t value, const char* suffix) {
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, value >>= 4) {
+        name[i] = digits[value & 15];
+    }
+    return name + suffix;
+}
+
+// 让cv::Mat持有缓存文件的映射：最后一个引用释放时解除映射。新分配仍交给默认分配器
+class MappedMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, flags, usageFlags);
+    }
+    void deallocate(cv::UMatData* data) const override {
+        if (data) {
+            delete static_cast<MappedFile*>(data->userdata);
+            delete data;
+        }
+    }
+};
+
+const MappedMatAllocator& mappedMatAllocator() {
+    static const MappedMatAllocator allocator;
+    return allocator;
+}
+
+cv::Mat wrapMapped(std::unique_ptr<MappedFile> file, const CacheHeader& header) {
+    uchar* pixels = file->writableData() + header.dataOffset;
+    cv::Mat image(header.rows, header.cols, header.type, pixels);
+    cv::UMatData* data = new cv::UMatData(&mappedMatAllocator());
+    data->data = data->origdata = pixels;
+    data->size = static_cast<size_t>(header.dataBytes);
+    data->refcount = 1;
+    data->userdata = file.release();
+    image.u = data;
+    return image;
+}
+
+bool readRef(const std::string& path, uint64_t& contentHash) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[8];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kRefMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&contentHash), sizeof(contentHash)));
+}
+
+// 先写临时文件再改名，并发写同一项时读者只会看到完整的文件
+bool writeAtomically(const fs::path& target, const std::function<bool(std::ofstream&)>& write) {
+    // 进程标记加计数器，GUI与批处理工具同时写同一目录时临时文件也不会重名
+    static const uint64_t processTag = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    fs::path temp = target;
+    temp += ".tmp-" + hexName(processTag, "-") + std::to_string(counter.fetch_add(1));
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out || !write(out) || !out.flush()) {
+            out.close();
+            std::error_code ec;
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, target, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+void writeRef(const fs::path& path, uint64_t contentHash) {
+    writeAtomically(path, [&](std::ofstream& out) {
+        out.write(kRefMagic, sizeof(kRefMagic));
+        out.write(reinterpret_cast<const char*>(&contentHash), sizeof(contentHash));
+        return static_cast<bool>(out);
+    });
+}
+
+} // namespace
+
+DecodeCache::DecodeCache(const std::string& directory, size_t sizeLimit)
+    : directory_(directory), sizeLimit_(sizeLimit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scanLocked();
+}
+
+bool DecodeCache::refPathFor(const std::string& path, std::string& refPath) const {
+    // 每次调用单独检查：共用一个error_code时后一次成功会掩盖前一次的失败，键里就混入了失败时的返回值
+    std::error_code sizeError, timeError, pathError;
+    const uintmax_t sourceSize = fs::file_size(path, sizeError);
+    const auto modified = fs::last_write_time(path, timeError);
+    const fs::path absolute = fs::absolute(path, pathError);
+    if (sizeError || timeError || pathError) {
+        return false;
+    }
+    // 同一路径、修改时间与大小时直接取上次记录的内容哈希
+    const uint64_t pathKey = hashString(absolute.string() + "|" + std::to_string(modified.time_since_epoch().count()) +
+                                        "|" + std::to_string(sourceSize), kVersion);
+    refPath = (fs::path(directory_) / hexName(pathKey, ".ref")).string();
+    return true;
+}
+
+cv::Mat DecodeCache::lookup(const std::string& path) {
+    TRACE_SCOPE("decodeCache.lookup");
+    std::string refPath;
+    uint64_t contentHash = 0;
+    if (!refPathFor(path, refPath) || !readRef(refPath, contentHash)) {
+        return cv::Mat();
+    }
+    cv::Mat image = mapEntry(contentHash);
+    if (image.empty()) {
+        std::error_code ec;
+        fs::remove(refPath, ec); // 像素文件已被淘汰，引用不再有用
+    } else {
+        std::error_code ec;
+        fs::last_write_time(fs::path(directory_) / hexName(contentHash, ".pix"), fs::file_time_type::clock::now(), ec);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.hits;
+    }
+    return image;
+}
+
+cv::Mat DecodeCache::load(const std::string& path, bool* hit) {
+    TRACE_SCOPE("decodeCache");
+    if (hit) {
+        *hit = false;
+    }
+    std::string refPath;
+    if (!refPathFor(path, refPath)) {
+        return readImage(path); // 源文件不可访问，交给readImage报告错误
+    }
+
+    // 内容哈希中包含扩展名，因为解码方式由它决定
+    const std::string ext = lowerExtension(path);
+    std::error_code ec;
+    uint64_t contentHash = 0;
+    cv::Mat image;
+    if (readRef(refPath, contentHash)) {
+        image = mapEntry(contentHash);
+    }
+    if (image.empty()) {
+        MappedFile source(path);
+        if (!source.isOpen()) {
+            return readImage(path);
+        }
+        contentHash = hashBytes(source.data(), source.size(), hashString(ext, kVersion));
+        source.close();
+        image = mapEntry(contentHash);
+        if (!image.empty()) {
+            writeRef(refPath, contentHash);
+        }
+    }
+
+    if (!image.empty()) {
+        // 以修改时间记录最近使用，淘汰时最久未用的先删除
+        fs::last_write_time(fs::path(directory_) / hexName(contentHash, ".pix"), fs::file_time_type::clock::now(), ec);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.hits;
+        if (hit) {
+            *hit = true;
+        }
+        return image;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.misses;
+    }
+    image = readImage(path);
+    if (!image.empty() && store(contentHash, image)) {
+        writeRef(refPath, contentHash);
+    }
+    return image;
+}
+
+cv::Mat DecodeCache::mapEntry(uint64_t contentHash) const {
+    const std::string path = (fs::path(directory_) / hexName(contentHash, ".pix")).string();
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->open(path, true)) {
+        return cv::Mat(); // 没有这一项
+    }
+    CacheHeader header;
+    if (file->size() < kDataOffset) {
+        std::cerr << "解码缓存文件已损坏，忽略: " << path << std::endl;
+        return cv::Mat();
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    const bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+                       header.contentHash == contentHash && header.rows > 0 && header.cols > 0 &&
+                       header.dataBytes == static_cast<uint64_t>(header.rows) * header.cols * CV_ELEM_SIZE(header.type) &&
+                       header.dataOffset + header.dataBytes <= file->size();
+    if (!valid) {
+        std::cerr << "解码缓存文件已损坏，忽略: " << path << std::endl;
+        return cv::Mat();
+    }
+    return wrapMapped(std::move(file), header);
+}
+
+bool DecodeCache::store(uint64_t contentHash, const cv::Mat& image) {
+    const uint64_t dataBytes = static_cast<uint64_t>(image.total()) * image.elemSize();
+    if (kDataOffset + dataBytes > sizeLimit() / 2) {
+        return false; // 单幅图像就占去一半以上的上限，不值得缓存
+    }
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.rows = image.rows;
+    header.cols = image.cols;
+    header.type = image.type();
+    header.contentHash = contentHash;
+    header.dataOffset = kDataOffset;
+    header.dataBytes = dataBytes;
+
+    const fs::path target = fs::path(directory_) / hexName(contentHash, ".pix");
+    bool written = writeAtomically(target, [&](std::ofstream& out) {
+        char padded[kDataOffset] = {};
+        std::memcpy(padded, &header, sizeof(header));
+        out.write(padded, sizeof(padded));
+        const std::streamsize rowBytes = static_cast<std::streamsize>(image.cols * image.elemSize());
+        for (int y = 0; y < image.rows && out; ++y) {
+            out.write(reinterpret_cast<const char*>(image.ptr(y)), rowBytes);
+        }
+        return static_cast<bool>(out);
+    });
+    if (!written) {
+        std::cerr << "写入解码缓存失败: " << target.string() << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    scanLocked();
+    evictLocked();
+    return true;
+}
+
+void DecodeCache::setSizeLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sizeLimit_ = bytes;
+    scanLocked();
+    evictLocked();
+}
+
+size_t DecodeCache::sizeLimit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sizeLimit_;
+}
+
+DecodeCache::Stats DecodeCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void DecodeCache::scanLocked() {
+    stats_.bytes = 0;
+    stats_.entries = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path ext = it->path().extension();
+        if (ext == ".pix") {
+            stats_.bytes += static_cast<size_t>(it->file_size(ec));
+            ++stats_.entries;
+        } else if (ext == ".ref") {
+            stats_.bytes += static_cast<size_t>(it->file_size(ec));
+        }
+    }
+}
+
+void DecodeCache::evictLocked() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        size_t bytes;
+        bool removed;
+    };
+    std::vector<Entry> pixels;
+    std::vector<Entry> refs;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path ext = it->path().extension();
+        if (ext == ".pix") {
+            pixels.push_back({it->path(), it->last_write_time(ec), static_cast<size_t>(it->file_size(ec)), false});
+        } else if (ext == ".ref") {
+            refs.push_back({it->path(), fs::file_time_type(), static_cast<size_t>(it->file_size(ec)), false});
+        }
+    }
+    if (stats_.bytes > sizeLimit_) {
+        std::sort(pixels.begin(), pixels.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+        // 已映射的文件删除后映射仍然有效，正在使用的图像不受影响
+        for (Entry& entry : pixels) {
+            if (stats_.bytes <= sizeLimit_) {
+                break;
+            }
+            if (fs::remove(entry.path, ec)) {
+                entry.removed = true;
+                stats_.bytes -= std::min(stats_.bytes, entry.bytes);
+                --stats_.entries;
+                ++stats_.evictions;
+            }
+        }
+    }
+
+    // 引用文件也计入上限：指向的像素文件已被淘汰（或源文件修改后从未再用）的引用一并删除，
+    // 否则每个 路径 + 修改时间 组合都会在目录里留下一个文件
+    std::unordered_set<std::string> alive;
+    for (const Entry& entry : pixels) {
+        if (!entry.removed) {
+            alive.insert(entry.path.filename().string());
+        }
+    }
+    for (const Entry& ref : refs) {
+        uint64_t contentHash = 0;
+        if ((!readRef(ref.path.string(), contentHash) || !alive.count(hexName(contentHash, ".pix"))) && fs::remove(ref.path, ec)) {
+            stats_.bytes -= std::min(stats_.bytes, ref.bytes);
+        }
+    }
+}
+
+std::string defaultDecodeCacheDirectory() {
+    if (const char* dir = std::getenv("IMAGE_CACHE_DIR")) {
+        if (*dir) {
+            return dir;
+        }
+    }
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (*xdg) {
+            return (fs::path(xdg) / "ImageProcessing").string();
+        }
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return (fs::path(home) / ".cache" / "ImageProcessing").string();
+    }
+    return (fs::temp_directory_path() / "ImageProcessing-cache").string();
+}
+
+DecodeCache& sharedDecodeCache() {
+    static DecodeCache cache(defaultDecodeCacheDirectory());
+    return cache;
+}
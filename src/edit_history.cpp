@@ -0,0 +1,209 @@
+#include "edit_history.h"
+#include "rle_codec.h"
+#include <algorithm>
+
+namespace {
+
+// 参与历史记录的字段；scale只与预览有关，不记录；导入的调色表不属于滑块状态，也不记录
+enum Field : uint8_t { Blur, BlurMethodField, Saturation, Contrast, Sharpen, Grayscale, Resize, ResizeWidth, ResizeHeight, LutSize, FieldCount };
+
+int fieldValue(const PipelineParams& params, int field) {
+    switch (field) {
+    case Blur: return params.blur;
+    case BlurMethodField: return static_cast<int>(params.blurMethod);
+    case Saturation: return params.saturation;
+    case Contrast: return params.contrast;
+    case Sharpen: return params.sharpen;
+    case Grayscale: return params.grayscale ? 1 : 0;
+    case Resize: return params.resize ? 1 : 0;
+    case ResizeWidth: return params.resizeWidth;
+    case ResizeHeight: return params.resizeHeight;
+    case LutSize: return params.lutSize;
+    default: return 0;
+    }
+}
+
+void setFieldValue(PipelineParams& params, int field, int value) {
+    switch (field) {
+    case Blur: params.blur = value; break;
+    case BlurMethodField: params.blurMethod = static_cast<BlurMethod>(value); break;
+    case Saturation: params.saturation = value; break;
+    case Contrast: params.contrast = value; break;
+    case Sharpen: params.sharpen = value; break;
+    case Grayscale: params.grayscale = value != 0; break;
+    case Resize: params.resize = value != 0; break;
+    case ResizeWidth: params.resizeWidth = value; break;
+    case ResizeHeight: params.resizeHeight = value; break;
+    case LutSize: params.lutSize = value; break;
+    default: break;
+    }
+}
+
+bool sameState(const PipelineParams& a, const PipelineParams& b) {
+    for (int field = 0; field < FieldCount; ++field) {
+        if (fieldValue(a, field) != fieldValue(b, field)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+EditHistory::EditHistory(const Options& options) : options_(options) {
+    reset(PipelineParams());
+}
+
+void EditHistory::reset(const PipelineParams& initial) {
+    steps_.clear();
+    Step first;
+    first.keyframe = true;
+    first.params = initial;
+    first.params.scale = 1.0;
+    steps_.push_back(first);
+    position_ = 0;
+}
+
+bool EditHistory::push(const PipelineParams& params) {
+    PipelineParams previous = paramsAt(position_);
+    if (sameState(previous, params)) {
+        return false;
+    }
+    steps_.erase(steps_.begin() + static_cast<std::ptrdiff_t>(position_ + 1), steps_.end());
+
+    // 距上一个关键帧满keyframeInterval步时记录完整参数，限制重放的长度
+    size_t sinceKeyframe = 0;
+    for (size_t i = position_; !steps_[i].keyframe; --i) {
+        ++sinceKeyframe;
+    }
+    Step step;
+    if (static_cast<int>(sinceKeyframe + 1) >= options_.keyframeInterval) {
+        step.keyframe = true;
+        step.params = params;
+        step.params.scale = 1.0;
+    } else {
+        for (int field = 0; field < FieldCount; ++field) {
+            int value = fieldValue(params, field);
+            if (value != fieldValue(previous, field)) {
+                step.changes.push_back({static_cast<uint8_t>(field), value});
+            }
+        }
+        step.changes.shrink_to_fit();
+    }
+    steps_.push_back(std::move(step));
+    ++position_;
+    enforceBudget();
+    return true;
+}
+
+bool EditHistory::wantsSnapshot() const {
+    const Step& step = steps_[position_];
+    return step.keyframe && step.snapshot.empty();
+}
+
+void EditHistory::attachSnapshot(const cv::Mat& rendered) {
+    if (!wantsSnapshot() || rendered.empty()) {
+        return;
+    }
+    std::vector<uchar> encoded = encodeRLE(rendered);
+    if (encoded.size() > options_.memoryBudget / 2) {
+        return; // 单个快照就占去一半以上预算，不值得保存
+    }
+    steps_[position_].snapshot = std::move(encoded);
+    enforceBudget();
+}
+
+void EditHistory::dropSnapshots() {
+    for (Step& step : steps_) {
+        std::vector<uchar>().swap(step.snapshot);
+    }
+}
+
+bool EditHistory::undo(PipelineParams& params, cv::Mat* snapshot) {
+    return canUndo() && moveTo(position_ - 1, params, snapshot);
+}
+
+bool EditHistory::redo(PipelineParams& params, cv::Mat* snapshot) {
+    return canRedo() && moveTo(position_ + 1, params, snapshot);
+}
+
+bool EditHistory::moveTo(size_t index, PipelineParams& params, cv::Mat* snapshot) {
+    position_ = index;
+    params = paramsAt(index);
+    if (snapshot) {
+        const std::vector<uchar>& data = steps_[index].snapshot;
+        *snapshot = data.empty() ? cv::Mat() : decodeRLE(data);
+    }
+    return true;
+}
+
+PipelineParams EditHistory::current() const {
+    return paramsAt(position_);
+}
+
+PipelineParams EditHistory::paramsAt(size_t index) const {
+    // 第一步总是关键帧，因此向前总能找到
+    size_t keyframe = index;
+    while (!steps_[keyframe].keyframe) {
+        --keyframe;
+    }
+    PipelineParams params = steps_[keyframe].params;
+    for (size_t i = keyframe + 1; i <= index; ++i) {
+        for (const Change& change : steps_[i].changes) {
+            setFieldValue(params, change.field, change.value);
+        }
+    }
+    return params;
+}
+
+EditHistory::Stats EditHistory::stats() const {
+    Stats stats;
+    stats.steps = steps_.size();
+    stats.position = position_;
+    for (const Step& step : steps_) {
+        stats.keyframes += step.keyframe ? 1 : 0;
+        stats.snapshots += step.snapshot.empty() ? 0 : 1;
+    }
+    stats.memoryUsage = memoryUsage();
+    return stats;
+}
+
+size_t EditHistory::memoryUsage() const {
+    size_t bytes = 0;
+    for (const Step& step : steps_) {
+        bytes += sizeof(Step) + step.changes.capacity() * sizeof(Change) + step.snapshot.capacity();
+    }
+    return bytes;
+}
+
+void EditHistory::setMemoryBudget(size_t bytes) {
+    options_.memoryBudget = bytes;
+    enforceBudget();
+}
+
+void EditHistory::enforceBudget() {
+    size_t usage = memoryUsage();
+    while (usage > options_.memoryBudget || steps_.size() > options_.maxSteps) {
+        // 先丢弃最旧的快照，参数本身很小，尽量保留可撤销的步数
+        auto oldest = std::find_if(steps_.begin(), steps_.end(), [](const Step& step) { return !step.snapshot.empty(); });
+        if (oldest != steps_.end() && steps_.size() <= options_.maxSteps) {
+            usage -= oldest->snapshot.capacity();
+            std::vector<uchar>().swap(oldest->snapshot);
+            continue;
+        }
+        if (position_ == 0) {
+            break; // 只剩当前状态及其重做分支，不能再丢
+        }
+        // 丢弃最旧的一步，下一步改为关键帧以保持可重建
+        Step& next = steps_[1];
+        if (!next.keyframe) {
+            next.params = paramsAt(1);
+            next.keyframe = true;
+            usage -= next.changes.capacity() * sizeof(Change);
+            std::vector<Change>().swap(next.changes);
+        }
+        usage -= sizeof(Step) + steps_.front().changes.capacity() * sizeof(Change) + steps_.front().snapshot.capacity();
+        steps_.pop_front();
+        --position_;
+    }
+}
@@ -0,0 +1,245 @@
+#include "fused_pipeline.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "border_math.h"
+#include "buffer_pool.h"
+#include "color_kernels.h"
+#include "color_math.h"
+#include "parallel_rows.h"
+#include "trace.h"
+
+namespace {
+
+struct FusedContext {
+    const cv::Mat* src = nullptr;
+    cv::Mat* dst = nullptr;
+    int saturation = 0;
+    uchar contrastLut[256];
+    float edge = 0;
+    float center = 1;
+    const HsvTables* tables = nullptr;
+
+    explicit FusedContext(const PipelineParams& params) : saturation(params.saturation), tables(&hsvTables()) {
+        // 与applyColorOps相同：convertTo的单精度乘法后取整
+        const float alpha = static_cast<float>(1 + params.contrast / 50.0);
+        for (int v = 0; v < 256; ++v) {
+            contrastLut[v] = cv::saturate_cast<uchar>(v * alpha);
+        }
+        if (params.sharpen != 0) {
+            sharpenCoefficients(params.sharpen, params.scale, edge, center);
+        }
+    }
+};
+
+// 逐像素运算（饱和度 -> 对比度），结果留在寄存器中
+template <unsigned Mask>
+inline void pointPixel(int& b, int& g, int& r, const FusedContext& c) {
+    if (Mask & FusedSaturation) {
+        int h, s, v;
+        bgrToHsv(b, g, r, *c.tables, h, s, v);
+        s = std::min(255, std::max(0, s + c.saturation));
+        hsvToBgr(h, s, v, b, g, r);
+    }
+    if (Mask & FusedContrast) {
+        b = c.contrastLut[b];
+        g = c.contrastLut[g];
+        r = c.contrastLut[r];
+    }
+}
+
+template <int Cn, unsigned Mask>
+void pointRow(const uchar* src, uchar* dst, int width, const FusedContext& c) {
+    if (Cn == 1 || !(Mask & FusedSaturation)) {
+        // 没有饱和度时逐字节查表即可
+        if (Mask & FusedContrast) {
+            for (int i = 0; i < width * Cn; ++i) {
+                dst[i] = c.contrastLut[src[i]];
+            }
+        } else {
+            std::memcpy(dst, src, static_cast<size_t>(width) * Cn);
+        }
+        return;
+    }
+    for (int x = 0; x < width; ++x, src += 3, dst += 3) {
+        int b = src[0], g = src[1], r = src[2];
+        pointPixel<Mask>(b, g, r, c);
+        dst[0] = static_cast<uchar>(b);
+        dst[1] = static_cast<uchar>(g);
+        dst[2] = static_cast<uchar>(r);
+    }
+}
+
+template <int Cn, unsigned Mask>
+void fusedRows(const FusedContext& c, const cv::Range& range) {
+    const cv::Mat& src = *c.src;
+    cv::Mat& dst = *c.dst;
+    const int width = src.cols;
+    const bool gray = Cn == 3 && (Mask & FusedGrayscale);
+
+    if (!(Mask & FusedSharpen)) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* in = src.ptr<uchar>(y);
+            uchar* out = dst.ptr<uchar>(y);
+            if (!gray) {
+                pointRow<Cn, Mask>(in, out, width, c);
+                continue;
+            }
+            for (int x = 0; x < width; ++x, in += 3) {
+                int b = in[0], g = in[1], r = in[2];
+                pointPixel<Mask>(b, g, r, c);
+                out[x] = static_cast<uchar>(bgrToGray(b, g, r));
+            }
+        }
+        return;
+    }
+
+    // 三行环形缓冲：每行是做完逐像素运算的结果，两端各多留一个像素按REFLECT_101填充
+    const int padded = (width + 2) * Cn;
+    std::vector<uchar> ring(static_cast<size_t>(3) * padded);
+    uchar* above = ring.data();
+    uchar* middle = above + padded;
+    uchar* below = middle + padded;
+    auto fill = [&](int y, uchar* row) {
+        pointRow<Cn, Mask>(src.ptr<uchar>(reflect101(y, src.rows)), row + Cn, width, c);
+        std::memcpy(row, row + Cn * (1 + reflect101(-1, width)), Cn);
+        std::memcpy(row + Cn * (width + 1), row + Cn * (1 + reflect101(width, width)), Cn);
+    };
+
+    fill(range.start - 1, above);
+    fill(range.start, middle);
+    const float edge = c.edge;
+    const float center = c.center;
+    for (int y = range.start; y < range.end; ++y) {
+        fill(y + 1, below);
+        uchar* out = dst.ptr<uchar>(y);
+        for (int x = 0; x < width; ++x) {
+            const uchar* t = above + (x + 1) * Cn;
+            const uchar* m = middle + (x + 1) * Cn;
+            const uchar* d = below + (x + 1) * Cn;
+            int v[Cn];
+            for (int ch = 0; ch < Cn; ++ch) {
+                // 与filter2D相同，按核中非零系数的行优先顺序累加
+                float s = 0.f;
+                s += edge * t[ch];
+                s += edge * m[ch - Cn];
+                s += center * m[ch];
+                s += edge * m[ch + Cn];
+                s += edge * d[ch];
+                v[ch] = cv::saturate_cast<uchar>(s);
+            }
+            if constexpr (Cn == 3) {
+                if (gray) {
+                    out[x] = static_cast<uchar>(bgrToGray(v[0], v[1], v[2]));
+                    continue;
+                }
+            }
+            for (int ch = 0; ch < Cn; ++ch) {
+                out[x * Cn + ch] = static_cast<uchar>(v[ch]);
+            }
+        }
+        uchar* rotated = above;
+        above = middle;
+        middle = below;
+        below = rotated;
+    }
+}
+
+using FusedRowsFn = void (*)(const FusedContext&, const cv::Range&);
+
+template <int Cn, size_t... Masks>
+constexpr std::array<FusedRowsFn, sizeof...(Masks)> makeVariants(std::index_sequence<Masks...>) {
+    return {{&fusedRows<Cn, static_cast<unsigned>(Masks)>...}};
+}
+
+// 按启用阶段的位掩码索引的分派表，每个通道数各一张
+constexpr std::array<FusedRowsFn, FusedStageCombinations> kColorVariants = makeVariants<3>(std::make_index_sequence<FusedStageCombinations>());
+constexpr std::array<FusedRowsFn, FusedStageCombinations> kGrayVariants = makeVariants<1>(std::make_index_sequence<FusedStageCombinations>());
+
+void runVariant(const cv::Mat& src, cv::Mat& dst, unsigned mask, const PipelineParams& params, bool serial) {
+    FusedContext context(params);
+    context.src = &src;
+    context.dst = &dst;
+    const FusedRowsFn rows = (src.channels() == 3 ? kColorVariants : kGrayVariants)[mask];
+    parallelRows(cv::Range(0, src.rows), [&](const cv::Range& range) { rows(context, range); }, serial);
+}
+
+bool runSelfCheck() {
+    // 宽度取奇数，使OpenCV的SIMD主循环之后还有尾部像素
+    cv::Mat sample(48, 61, CV_8UC3);
+    uint32_t state = 2463534242u;
+    for (int y = 0; y < sample.rows; ++y) {
+        uchar* row = sample.ptr<uchar>(y);
+        for (int x = 0; x < sample.cols * 3; ++x) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            row[x] = static_cast<uchar>(state >> 24);
+        }
+    }
+    cv::Mat graySample;
+    cv::cvtColor(sample, graySample, cv::COLOR_BGR2GRAY);
+
+    for (const cv::Mat& input : {sample, graySample}) {
+        for (unsigned mask = 0; mask < FusedStageCombinations; ++mask) {
+            PipelineParams params;
+            params.saturation = (mask & FusedSaturation) ? 37 : 0;
+            params.contrast = (mask & FusedContrast) ? -23 : 0;
+            params.sharpen = (mask & FusedSharpen) ? 7 : 0;
+            params.grayscale = (mask & FusedGrayscale) != 0;
+            if (input.channels() == 1 && (mask & (FusedSaturation | FusedGrayscale))) {
+                continue;
+            }
+
+            cv::Mat expected = input.clone();
+            ColorOps ops;
+            ops.saturation = params.saturation;
+            ops.contrast = params.contrast;
+            applyColorOps(expected, expected, ops);
+            applySharpenStage(expected, expected, params.sharpen, params.scale);
+            applyGrayscaleStage(expected, expected, params.grayscale);
+
+            cv::Mat actual(input.size(), CV_8UC(params.grayscale ? 1 : input.channels()));
+            runVariant(input, actual, mask, params, false);
+            if (cv::norm(expected, actual, cv::NORM_INF) > ((mask & FusedSharpen) ? 1 : 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+unsigned fusedStageMask(const PipelineParams& params, int channels) {
+    unsigned mask = 0;
+    if (params.saturation != 0 && channels == 3) mask |= FusedSaturation;
+    if (params.contrast != 0) mask |= FusedContrast;
+    if (params.sharpen != 0) mask |= FusedSharpen;
+    if (params.grayscale && channels == 3) mask |= FusedGrayscale;
+    return mask;
+}
+
+bool fusedStagesMatchOpenCV() {
+    static const bool matches = runSelfCheck();
+    return matches;
+}
+
+bool applyFusedStages(const cv::Mat& src, cv::Mat& dst, const PipelineParams& params, bool serial) {
+    if (src.type() != CV_8UC3 && src.type() != CV_8UC1) {
+        return false;
+    }
+    const unsigned mask = fusedStageMask(params, src.channels());
+    if (!(mask & (FusedSharpen | FusedGrayscale)) || !fusedStagesMatchOpenCV()) {
+        return false;
+    }
+
+    TRACE_SCOPE_IMAGE("fused", src);
+    // 锐化要读上下相邻的行，不能原地写；灰度输出的通道数也不同，因此总是写入新的缓冲区
+    cv::Mat out = sharedBufferPool().acquire(src.size(), CV_8UC((mask & FusedGrayscale) ? 1 : src.channels()));
+    runVariant(src, out, mask, params, serial);
+    dst = out;
+    return true;
+}
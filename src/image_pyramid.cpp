@@ -0,0 +1,132 @@
+#include "image_pyramid.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+
+ImagePyramid::ImagePyramid(int tileSize) : tileSize_(std::max(16, tileSize)) {}
+
+void ImagePyramid::setImage(const cv::Mat& image) {
+    // 各层的缓冲区留给新图像复用：尺寸与类型不变时（例如拖动滑块时的连续帧）不重新分配
+    std::vector<Level> previous;
+    previous.swap(levels_);
+    stats_ = Stats();
+    if (image.empty()) {
+        return;
+    }
+    Level base;
+    base.size = image.size();
+    base.image = image;
+    levels_.push_back(base);
+    // 一直减半到整层只剩一个瓦片
+    cv::Size size = image.size();
+    while (size.width > tileSize_ || size.height > tileSize_) {
+        size = cv::Size((size.width + 1) / 2, (size.height + 1) / 2);
+        Level level;
+        level.size = size;
+        level.tilesX = (size.width + tileSize_ - 1) / tileSize_;
+        level.tilesY = (size.height + tileSize_ - 1) / tileSize_;
+        if (levels_.size() < previous.size()) {
+            level.image = previous[levels_.size()].image; // 瓦片标记为未计算，用到时在ensure中按需重建
+        }
+        levels_.push_back(level);
+    }
+}
+
+void ImagePyramid::clear() {
+    levels_.clear();
+    stats_ = Stats();
+}
+
+cv::Size ImagePyramid::size() const {
+    return levels_.empty() ? cv::Size() : levels_[0].size;
+}
+
+int ImagePyramid::levelForScale(double scale) const {
+    if (levels_.empty() || scale >= 1.0 || scale <= 0) {
+        return 0;
+    }
+    int level = static_cast<int>(std::floor(std::log2(1.0 / scale)));
+    return std::min(level, levelCount() - 1);
+}
+
+void ImagePyramid::ensure(int level, const cv::Rect& rect) {
+    if (level == 0) {
+        return;
+    }
+    Level& current = levels_[level];
+    if (current.ready.empty()) {
+        current.image.create(current.size, levels_[0].image.type()); // 复用的缓冲区尺寸与类型相同时不重新分配
+        current.ready.assign(static_cast<size_t>(current.tilesX) * current.tilesY, 0);
+        stats_.levelBytes += current.image.total() * current.image.elemSize();
+    }
+    cv::Rect clipped = rect & cv::Rect(0, 0, current.size.width, current.size.height);
+    if (clipped.empty()) {
+        return;
+    }
+    for (int ty = clipped.y / tileSize_; ty <= (clipped.y + clipped.height - 1) / tileSize_; ++ty) {
+        for (int tx = clipped.x / tileSize_; tx <= (clipped.x + clipped.width - 1) / tileSize_; ++tx) {
+            if (!current.ready[static_cast<size_t>(ty) * current.tilesX + tx]) {
+                buildTile(level, tx, ty);
+            }
+        }
+    }
+}
+
+void ImagePyramid::buildTile(int level, int tileX, int tileY) {
+    Level& current = levels_[level];
+    const cv::Size& finer = levels_[level - 1].size;
+    cv::Rect target(tileX * tileSize_, tileY * tileSize_, tileSize_, tileSize_);
+    target &= cv::Rect(0, 0, current.size.width, current.size.height);
+    // 上一层对应的2倍区域；奇数边长时最后一列/行只剩一个像素
+    cv::Rect source(target.x * 2, target.y * 2, target.width * 2, target.height * 2);
+    source &= cv::Rect(0, 0, finer.width, finer.height);
+
+    ensure(level - 1, source);
+    TRACE_SCOPE("pyramid.tile");
+    cv::Mat dst = current.image(target);
+    cv::resize(levels_[level - 1].image(source), dst, target.size(), 0, 0, cv::INTER_AREA);
+    current.ready[static_cast<size_t>(tileY) * current.tilesX + tileX] = 1;
+    ++stats_.tilesBuilt;
+}
+
+void ImagePyramid::render(const cv::Rect2d& view, cv::Size dstSize, cv::Mat& dst, const cv::Scalar& background) {
+    if (levels_.empty() || dstSize.width <= 0 || dstSize.height <= 0 || view.width <= 0 || view.height <= 0) {
+        dst.release();
+        return;
+    }
+    TRACE_SCOPE("pyramid.render");
+    dst.create(dstSize, levels_[0].image.type());
+
+    const int level = levelForScale(dstSize.width / view.width);
+    const Level& chosen = levels_[level];
+    // 该层相对源图像的比例（按实际尺寸计算，奇数边长向上取整的误差也考虑在内）
+    const double fx = static_cast<double>(chosen.size.width) / levels_[0].size.width;
+    const double fy = static_cast<double>(chosen.size.height) / levels_[0].size.height;
+    const cv::Rect2d levelView(view.x * fx, view.y * fy, view.width * fx, view.height * fy);
+    const double sx = dstSize.width / levelView.width;  // 目标像素/该层像素，约在(0.5, ∞)
+    const double sy = dstSize.height / levelView.height;
+
+    // 目标图像中被图像覆盖的部分，其余填背景
+    cv::Rect covered(cvFloor(-levelView.x * sx), cvFloor(-levelView.y * sy),
+                     cvCeil(chosen.size.width * sx), cvCeil(chosen.size.height * sy));
+    covered &= cv::Rect(0, 0, dstSize.width, dstSize.height);
+    if (covered != cv::Rect(0, 0, dstSize.width, dstSize.height)) {
+        dst.setTo(background);
+    }
+    if (covered.empty()) {
+        return;
+    }
+
+    // 只计算covered用到的区域（两侧各多留一个像素供双线性插值）
+    cv::Rect needed(cvFloor(levelView.x + covered.x / sx) - 1, cvFloor(levelView.y + covered.y / sy) - 1,
+                    cvCeil(covered.width / sx) + 3, cvCeil(covered.height / sy) + 3);
+    needed &= cv::Rect(0, 0, chosen.size.width, chosen.size.height);
+    ensure(level, needed);
+
+    // 目标像素(u, v)的中心对应该层坐标 levelView.x + (covered.x + u + 0.5) / sx，再换算为needed内的像素下标
+    cv::Matx23d inverse(1.0 / sx, 0, levelView.x + (covered.x + 0.5) / sx - 0.5 - needed.x,
+                        0, 1.0 / sy, levelView.y + (covered.y + 0.5) / sy - 0.5 - needed.y);
+    cv::Mat out = dst(covered);
+    int interpolation = sx >= 4.0 ? cv::INTER_NEAREST : cv::INTER_LINEAR; // 放大很多时看清单个像素
+    cv::warpAffine(chosen.image(needed), out, inverse, covered.size(), interpolation | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+}
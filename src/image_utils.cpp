@@ -1,18 +1,151 @@
 #include "image_utils.h"
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <iostream>
+#include "pnm_reader.h"
+#include "rle_codec.h"
+#include "strip_io.h"
+#include "trace.h"
+
+#ifdef IMAGE_UTILS_WITH_PYTHON
 #include <Python.h>
+#endif
 
-cv::Mat readImage(const std::string& path) {
-    if (path.substr(path.find_last_of(".") + 1) == "ppm") {
-        return readPPM(path);
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string lowerExtension(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return ""; // 点在目录名中，文件本身没有扩展名
+    }
+    return lowercase(path.substr(dot + 1));
+}
+
+namespace {
+
+// 保留文件的通道数（灰度图像为单通道），位深统一为8位
+cv::Mat readImageFile(const std::string& path) {
+    std::string ext = lowerExtension(path);
+    if (ext == "ppm" || ext == "pgm" || ext == "pnm") {
+        return readPNM(path, cv::IMREAD_ANYCOLOR);
+    } else if (ext == "rle") {
+        MappedFile file(path);
+        if (!file.isOpen()) {
+            std::cerr << "无法打开RLE文件: " << path << std::endl;
+            return cv::Mat();
+        }
+        return decodeRLE(file.data(), file.size());
     } else {
-        return cv::imread(path, cv::IMREAD_COLOR);
+        return cv::imread(path, cv::IMREAD_ANYCOLOR);
+    }
+}
+
+// 从JPEG的SOF段读出图像尺寸，只访问文件开头的几个段
+bool jpegSize(const unsigned char* data, size_t size, cv::Size& result) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        const unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) {
+            ++pos; // 填充字节
+            continue;
+        }
+        const size_t length = (data[pos + 2] << 8) | data[pos + 3];
+        // SOF0..SOF15，除去DHT(C4)、JPG(C8)与DAC(CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (pos + 9 > size) {
+                return false;
+            }
+            result = cv::Size((data[pos + 7] << 8) | data[pos + 8], (data[pos + 5] << 8) | data[pos + 6]);
+            return result.area() > 0;
+        }
+        if (marker == 0xDA || length < 2) {
+            return false; // 扫描数据之前没有SOF
+        }
+        pos += 2 + length;
     }
+    return false;
+}
+
+// 长宽各缩小为1/scale后像素数不超过maxPixels的最小scale（2、4或8）；原图已不超过时返回0
+int previewScale(cv::Size size, size_t maxPixels) {
+    const double pixels = static_cast<double>(size.width) * size.height;
+    if (pixels <= maxPixels) {
+        return 0;
+    }
+    for (int scale : {2, 4}) {
+        if (pixels / (scale * scale) <= maxPixels) {
+            return scale;
+        }
+    }
+    return 8;
+}
+
+} // namespace
+
+cv::Mat readImage(const std::string& path) {
+    TraceScope trace("readImage");
+    cv::Mat image = readImageFile(path);
+    trace.setImage(image);
+    return image;
+}
+
+cv::Mat readImagePreview(const std::string& path, int* scale, size_t maxPixels) {
+    TraceScope trace("readImagePreview");
+    std::string ext = lowerExtension(path);
+    cv::Mat preview;
+    int chosen = 0;
+    if (ext == "jpg" || ext == "jpeg") {
+        MappedFile file(path);
+        cv::Size size;
+        if (!file.isOpen() || !jpegSize(file.data(), file.size(), size) || (chosen = previewScale(size, maxPixels)) == 0) {
+            return cv::Mat();
+        }
+        file.close();
+        // libjpeg在反DCT时直接输出1/2、1/4或1/8尺寸，省去大部分解码工作
+        const int flags = chosen == 2 ? cv::IMREAD_REDUCED_COLOR_2 : (chosen == 4 ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_COLOR_8);
+        preview = cv::imread(path, flags);
+    } else if (ext == "ppm" || ext == "pgm" || ext == "pnm") {
+        // 8位二进制PNM直接在映射内存上隔行隔列取样，跳过的行不会被读入
+        PNMView view;
+        if (!view.open(path) || !view.canWrap()) {
+            return cv::Mat();
+        }
+        cv::Mat full = view.image();
+        if ((chosen = previewScale(full.size(), maxPixels)) == 0) {
+            return cv::Mat();
+        }
+        cv::Size size((full.cols + chosen - 1) / chosen, (full.rows + chosen - 1) / chosen);
+        cv::resize(full, preview, size, 0, 0, cv::INTER_NEAREST);
+        if (preview.channels() == 3) {
+            cv::cvtColor(preview, preview, cv::COLOR_RGB2BGR);
+        }
+    }
+    if (scale) {
+        *scale = preview.empty() ? 0 : chosen;
+    }
+    trace.setImage(preview);
+    return preview;
 }
 
 cv::Mat readPPM(const std::string& path) {
+    // 原生解析PNM（P2/P3/P5/P6），直接在映射内存上解码为BGR，不落盘
+    return readPNM(path, cv::IMREAD_COLOR);
+}
+
+#ifdef IMAGE_UTILS_WITH_PYTHON
+cv::Mat readPPMWithPython(const std::string& path) {
     // 初始化Python解释器
     Py_Initialize();
 
@@ -62,21 +195,34 @@ def convert_ppm_to_png(ppm_path, png_path):
     std::string pngPath = path.substr(0, path.find_last_of(".")) + ".png";
     return cv::imread(pngPath, cv::IMREAD_COLOR);
 }
+#endif
 
-void writePPM(const std::string& path, const cv::Mat& image) {
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "无法写入PPM文件" << std::endl;
-        return;
+bool writePPM(const std::string& path, const cv::Mat& image) {
+    // 逐行转换为RGB后写出，不再生成整幅RGB副本；单通道图像写为P5
+    PPMStripWriter writer;
+    if (!writer.begin(path, image.size(), image.channels())) {
+        return false;
     }
+    if (!writer.write(image) || !writer.finish()) {
+        std::cerr << "写入PPM文件失败" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // PPM格式的图像数据是RGB格式，需要转换为RGB格式以便保存
-    cv::Mat rgbImage;
-    cv::cvtColor(image, rgbImage, cv::COLOR_BGR2RGB);
-
-    file << "P6\n" << rgbImage.cols << " " << rgbImage.rows << "\n255\n";
-    file.write(reinterpret_cast<const char*>(rgbImage.data), rgbImage.cols * rgbImage.rows * 3);
-    file.close();
+bool writeImage(const std::string& path, const cv::Mat& image) {
+    TRACE_SCOPE_IMAGE("writeImage", image);
+    std::string ext = lowerExtension(path);
+    if (ext == "ppm" || ext == "pgm" || ext == "pnm") {
+        return writePPM(path, image);
+    }
+    if (ext == "rle") {
+        std::vector<uchar> encoded = encodeRLE(image);
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        return !encoded.empty() && static_cast<bool>(file);
+    }
+    return cv::imwrite(path, image);
 }
 
 cv::Mat convertToGrayscale(const cv::Mat& image) {
@@ -92,20 +238,9 @@ cv::Mat resizeImage(const cv::Mat& image, int width, int height) {
 }
 
 std::vector<uchar> compressImage(const cv::Mat& image) {
-    std::vector<uchar> compressedData;
-    // 简单的RLE压缩算法
-    for (int i = 0; i < image.rows; ++i) {
-        const uchar* row = image.ptr<uchar>(i);
-        for (int j = 0; j < image.cols; ++j) {
-            uchar value = row[j];
-            int count = 1;
-            while (j + 1 < image.cols && row[j + 1] == value) {
-                ++count;
-                ++j;
-            }
-            compressedData.push_back(value);
-            compressedData.push_back(count);
-        }
-    }
-    return compressedData;
-}
\ No newline at end of file
+    return encodeRLE(image);
+}
+
+cv::Mat decompressImage(const std::vector<uchar>& data) {
+    return decodeRLE(data);
+}
@@ -0,0 +1,669 @@
+#include "job_server.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "image_utils.h"
+#include "pipeline.h"
+#include "tiled_pipeline.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// POSIX共享内存段的映射，析构时解除映射（不unlink，段的生命周期由创建方决定）
+class SharedMemory {
+public:
+    SharedMemory() = default;
+    ~SharedMemory() { close(); }
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    bool openReadOnly(const std::string& name, size_t size) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= size && map(fd, size, PROT_READ);
+        ::close(fd);
+        return ok;
+    }
+
+    bool create(const std::string& name, size_t size) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ftruncate(fd, static_cast<off_t>(size)) == 0 && map(fd, size, PROT_READ | PROT_WRITE);
+        ::close(fd);
+        if (!ok) {
+            shm_unlink(name.c_str());
+        }
+        return ok;
+    }
+
+    void close() {
+        if (data_) {
+            munmap(data_, size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    unsigned char* data() const { return static_cast<unsigned char*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    bool map(int fd, size_t size, int protection) {
+        void* data = mmap(nullptr, std::max<size_t>(size, 1), protection, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = data;
+        size_ = size;
+        return true;
+    }
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 一个客户端连接：读取在连接自己的线程上进行，回复可能来自调度线程，写入时加锁
+class Connection {
+public:
+    explicit Connection(int fd) : fd_(fd) {}
+    ~Connection() { ::close(fd_); }
+
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t newline = buffer_.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer_.substr(0, newline);
+                buffer_.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return true;
+            }
+            char chunk[4096];
+            ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                return false;
+            }
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    // 客户端已断开时返回false，调用方负责回收只有客户端才会释放的资源
+    bool send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::string data = line + "\n";
+        const char* p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::send(fd_, p, left, 0);
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void shutdown() { ::shutdown(fd_, SHUT_RDWR); }
+
+private:
+    int fd_;
+    std::string buffer_;
+    std::mutex writeMutex_;
+};
+
+using Fields = std::map<std::string, std::string>;
+
+// "cmd\tkey=value\t..." -> 命令与字段
+std::string parseLine(const std::string& line, Fields& fields) {
+    std::stringstream stream(line);
+    std::string command;
+    std::getline(stream, command, '\t');
+    std::string item;
+    while (std::getline(stream, item, '\t')) {
+        size_t eq = item.find('=');
+        if (eq != std::string::npos) {
+            fields[item.substr(0, eq)] = item.substr(eq + 1);
+        }
+    }
+    return command;
+}
+
+// 错误信息放进一行回复的一个字段里（OpenCV的异常信息带换行），制表符与换行都换成空格
+std::string replyField(std::string text) {
+    std::replace_if(text.begin(), text.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return text;
+}
+
+// 结果放入共享内存时支持的格式；raw为原始像素，其余用cv::imencode编码
+bool isSupportedFormat(const std::string& format) {
+    if (format == "raw") {
+        return true;
+    }
+    return (format == "png" || format == "jpg" || format == "ppm" || format == "pgm") && cv::haveImageWriter("." + format);
+}
+
+// 写文件时按扩展名选择writeImage的原生写出或cv::imwrite，后者必须有对应的编码器，否则imwrite会抛出异常
+bool isSupportedOutputPath(const std::string& path) {
+    const std::string ext = lowerExtension(path);
+    if (ext.empty()) {
+        return false;
+    }
+    return ext == "ppm" || ext == "pgm" || ext == "pnm" || ext == "rle" || cv::haveImageWriter(path);
+}
+
+struct Job {
+    std::shared_ptr<Connection> connection;
+    std::string id;
+    cv::Mat image;                       // 解码结果，或映射客户端共享内存的Mat（不拥有像素）
+    std::unique_ptr<SharedMemory> input; // shm输入的映射，作业完成前保持
+    PipelineParams params;
+    std::string format;
+    std::string outputPath;
+    Clock::time_point received;
+    Clock::time_point queued;
+};
+
+// 服务端的计数与最近完成作业的延迟，供stats命令汇总
+class Metrics {
+public:
+    static const size_t kRecent = 1024;
+
+    Metrics() : start_(Clock::now()) {}
+
+    void batch(size_t jobs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++batches_;
+        batchedJobs_ += jobs;
+    }
+
+    void finished(double totalMs, bool ok) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) {
+            ++failed_;
+            return;
+        }
+        ++jobs_;
+        if (latencies_.size() == kRecent) {
+            latencies_.pop_front();
+            completions_.pop_front();
+        }
+        latencies_.push_back(totalMs);
+        completions_.push_back(Clock::now());
+    }
+
+    std::string report(size_t queued, size_t maxQueued) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Clock::time_point now = Clock::now();
+        const double uptime = millisBetween(start_, now) / 1000;
+        std::vector<double> sorted(latencies_.begin(), latencies_.end());
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) {
+            return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+        };
+        // 最近kRecent个作业的完成速率，反映当前负载下的吞吐量
+        double recent = 0;
+        if (completions_.size() > 1) {
+            double span = millisBetween(completions_.front(), completions_.back()) / 1000;
+            recent = span > 0 ? (completions_.size() - 1) / span : 0;
+        }
+        std::ostringstream out;
+        out << "stats\tjobs=" << jobs_ << "\tfailed=" << failed_ << "\tqueued=" << queued << "\tmax_queued=" << maxQueued
+            << "\tbatches=" << batches_ << "\tavg_batch=" << (batches_ ? static_cast<double>(batchedJobs_) / batches_ : 0.0)
+            << "\tjobs_per_s=" << (uptime > 0 ? jobs_ / uptime : 0.0) << "\trecent_jobs_per_s=" << recent
+            << "\tlatency_p50_ms=" << percentile(0.50) << "\tlatency_p99_ms=" << percentile(0.99) << "\tuptime_s=" << uptime;
+        return out.str();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    Clock::time_point start_;
+    uint64_t jobs_ = 0;
+    uint64_t failed_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t batchedJobs_ = 0;
+    std::deque<double> latencies_;
+    std::deque<Clock::time_point> completions_;
+};
+
+// 作业队列：按到达顺序排队，调度线程一次取出与队首尺寸、类型相同的若干作业
+class JobQueue {
+public:
+    explicit JobQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    bool push(std::unique_ptr<Job> job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&]() { return closed_ || jobs_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+        maxQueued_ = std::max(maxQueued_, jobs_.size());
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // 等待第一个作业，然后在window内继续收集同尺寸同类型的作业，凑满maxBatch个即返回。
+    // 队列关闭且为空时返回false
+    bool popBatch(std::vector<std::unique_ptr<Job>>& batch, size_t maxBatch, std::chrono::microseconds window) {
+        batch.clear();
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&]() { return closed_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return false;
+        }
+        batch.push_back(std::move(jobs_.front()));
+        jobs_.pop_front();
+        const cv::Size size = batch.front()->image.size();
+        const int type = batch.front()->image.type();
+        const Clock::time_point deadline = Clock::now() + window;
+        for (;;) {
+            for (auto it = jobs_.begin(); it != jobs_.end() && batch.size() < maxBatch;) {
+                if ((*it)->image.size() == size && (*it)->image.type() == type) {
+                    batch.push_back(std::move(*it));
+                    it = jobs_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            // 队列中剩下的都是尺寸不同的作业，只等新到的作业
+            const size_t waiting = jobs_.size();
+            if (batch.size() >= maxBatch || closed_ ||
+                !notEmpty_.wait_until(lock, deadline, [&]() { return closed_ || jobs_.size() > waiting; })) {
+                break;
+            }
+        }
+        notFull_.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return jobs_.size();
+    }
+
+    size_t maxQueued() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return maxQueued_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<std::unique_ptr<Job>> jobs_;
+    size_t capacity_;
+    size_t maxQueued_ = 0;
+    bool closed_ = false;
+};
+
+class JobServer {
+public:
+    explicit JobServer(const JobServerOptions& options) : options_(options), queue_(options.maxQueued) {}
+
+    int run();
+
+private:
+    void serveConnection(std::shared_ptr<Connection> connection);
+    void acceptJob(const std::shared_ptr<Connection>& connection, const Fields& fields);
+    void dispatch();
+    void processJob(Job& job, size_t batchSize, Clock::time_point started, bool tiled);
+    void finishJob(Job& job, const cv::Mat& result, size_t batchSize, Clock::time_point started, Clock::time_point processed);
+    void failJob(Job& job, const std::string& message);
+    void stop();
+
+    JobServerOptions options_;
+    JobQueue queue_;
+    Metrics metrics_;
+    int listenFd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> outputCounter_{0};
+    std::mutex connectionsMutex_;
+    std::vector<std::weak_ptr<Connection>> connections_;
+};
+
+void JobServer::acceptJob(const std::shared_ptr<Connection>& connection, const Fields& fields) {
+    auto field = [&](const char* key) {
+        auto it = fields.find(key);
+        return it == fields.end() ? std::string() : it->second;
+    };
+    const std::string id = field("id");
+    auto fail = [&](const std::string& message) {
+        metrics_.finished(0, false);
+        connection->send("error\tid=" + id + "\tmessage=" + replyField(message));
+    };
+
+    std::unique_ptr<Job> job(new Job());
+    job->connection = connection;
+    job->id = id;
+    job->received = Clock::now();
+    job->outputPath = field("output");
+    job->format = lowercase(field("format"));
+    if (job->format.empty()) {
+        job->format = job->outputPath.empty() ? "png" : "";
+    }
+    // 格式在排队前检查，处理完才发现没有编码器时cv::imencode/imwrite会抛出异常
+    if (!job->outputPath.empty()) {
+        if (!isSupportedOutputPath(job->outputPath)) {
+            fail("Unsupported output extension: " + job->outputPath);
+            return;
+        }
+    } else if (!isSupportedFormat(job->format)) {
+        fail("Unsupported output format: " + job->format);
+        return;
+    }
+    std::string error;
+    if (!parsePipelineSpec(field("pipeline"), job->params, &error)) {
+        fail(error);
+        return;
+    }
+
+    // 解码在连接线程上完成，调度线程拿到的都是已知尺寸的像素，可以按尺寸合批
+    if (!field("input").empty()) {
+        try {
+            job->image = readImage(field("input"));
+        } catch (const std::exception& e) {
+            fail("Unable to read image: " + field("input") + ": " + e.what());
+            return;
+        }
+        if (job->image.empty()) {
+            fail("Unable to read image: " + field("input"));
+            return;
+        }
+    } else if (!field("shm").empty()) {
+        const int width = std::atoi(field("width").c_str());
+        const int height = std::atoi(field("height").c_str());
+        const int channels = std::atoi(field("channels").c_str());
+        if (width <= 0 || height <= 0 || (channels != 1 && channels != 3)) {
+            fail("Invalid shared memory image size");
+            return;
+        }
+        job->input.reset(new SharedMemory());
+        const size_t bytes = static_cast<size_t>(width) * height * channels;
+        if (!job->input->openReadOnly(field("shm"), bytes)) {
+            fail("Unable to map shared memory: " + field("shm"));
+            return;
+        }
+        // 只读映射上的Mat头，处理链会先复制一份再原地处理，不会写入客户端的缓冲区
+        job->image = cv::Mat(height, width, CV_8UC(channels), job->input->data());
+    } else {
+        fail("Missing input or shm");
+        return;
+    }
+
+    job->queued = Clock::now();
+    if (!queue_.push(std::move(job))) {
+        fail("Server is shutting down");
+    }
+}
+
+void JobServer::failJob(Job& job, const std::string& message) {
+    metrics_.finished(0, false);
+    job.connection->send("error\tid=" + job.id + "\tmessage=" + replyField(message));
+}
+
+// 执行一个作业并回复；处理或编码中的异常转为error回复，不让它离开调度线程（或parallel_for_）终止整个服务
+void JobServer::processJob(Job& job, size_t batchSize, Clock::time_point started, bool tiled) {
+    try {
+        cv::Mat result = tiled ? applyPipelineTiled(job.image, job.params) : applyPipeline(job.image, job.params);
+        finishJob(job, result, batchSize, started, Clock::now());
+    } catch (const std::exception& e) {
+        failJob(job, std::string("Processing failed: ") + e.what());
+    }
+}
+
+void JobServer::finishJob(Job& job, const cv::Mat& result, size_t batchSize, Clock::time_point started, Clock::time_point processed) {
+    auto fail = [&](const std::string& message) { failJob(job, message); };
+    if (result.empty()) {
+        fail("Processing failed");
+        return;
+    }
+
+    std::ostringstream reply;
+    reply << "ok\tid=" << job.id;
+    size_t bytes = 0;
+    std::string outputName; // 新建的共享内存段，回复没能送达时由服务端删除
+    if (!job.outputPath.empty()) {
+        if (!writeImage(job.outputPath, result)) {
+            fail("Failed to write image: " + job.outputPath);
+            return;
+        }
+        reply << "\toutput=" << job.outputPath;
+    } else {
+        // 编码结果（或原始像素）放入新建的共享内存段，客户端直接映射，不经过套接字传输
+        std::vector<uchar> encoded;
+        const bool raw = job.format == "raw";
+        if (raw) {
+            bytes = result.total() * result.elemSize();
+        } else if (cv::imencode("." + job.format, result, encoded)) {
+            bytes = encoded.size();
+        } else {
+            fail("Unsupported output format: " + job.format);
+            return;
+        }
+        // macOS的共享内存名最长31个字符
+        const std::string name = "/ipjob-" + std::to_string(getpid()) + "-" + std::to_string(++outputCounter_);
+        SharedMemory output;
+        if (!output.create(name, bytes)) {
+            fail("Unable to create shared memory");
+            return;
+        }
+        if (raw) {
+            result.copyTo(cv::Mat(result.rows, result.cols, result.type(), output.data()));
+        } else {
+            std::memcpy(output.data(), encoded.data(), bytes);
+        }
+        reply << "\tshm=" << name << "\tbytes=" << bytes;
+        outputName = name;
+    }
+
+    const Clock::time_point done = Clock::now();
+    const double totalMs = millisBetween(job.received, done);
+    reply << "\twidth=" << result.cols << "\theight=" << result.rows << "\tchannels=" << result.channels()
+          << "\tbatch=" << batchSize << "\tqueue_ms=" << millisBetween(job.queued, started)
+          << "\tprocess_ms=" << millisBetween(started, processed) << "\ttotal_ms=" << totalMs;
+    const bool delivered = job.connection->send(reply.str());
+    if (!delivered && !outputName.empty()) {
+        shm_unlink(outputName.c_str()); // 客户端已断开，没有人会再映射并删除这个段
+    }
+    metrics_.finished(totalMs, delivered);
+}
+
+void JobServer::dispatch() {
+    std::vector<std::unique_ptr<Job>> batch;
+    const auto window = std::chrono::microseconds(static_cast<long long>(options_.batchWindowMs * 1000));
+    while (queue_.popBatch(batch, static_cast<size_t>(std::max(1, options_.maxBatch)), window)) {
+        metrics_.batch(batch.size());
+        const Clock::time_point started = Clock::now();
+        if (batch.size() == 1) {
+            // 单个作业时并行度来自图像内部的分块
+            processJob(*batch.front(), 1, started, true);
+            continue;
+        }
+        // 同尺寸的作业代价相近，按作业并行可以均匀分摊；各作业内部的OpenCV调用在嵌套时串行执行
+        TRACE_SCOPE("jobBatch");
+        cv::parallel_for_(cv::Range(0, static_cast<int>(batch.size())), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                processJob(*batch[i], batch.size(), started, false);
+            }
+        });
+    }
+}
+
+void JobServer::serveConnection(std::shared_ptr<Connection> connection) {
+    std::string line;
+    while (connection->readLine(line)) {
+        if (line.empty()) {
+            continue;
+        }
+        Fields fields;
+        const std::string command = parseLine(line, fields);
+        if (command == "job") {
+            acceptJob(connection, fields);
+        } else if (command == "stats") {
+            connection->send(metrics_.report(queue_.size(), queue_.maxQueued()));
+        } else if (command == "shutdown") {
+            connection->send("ok");
+            stop();
+            break;
+        } else {
+            connection->send("error\tmessage=Unknown command: " + command);
+        }
+    }
+}
+
+void JobServer::stop() {
+    // 监听循环定期检查该标志；已排队的作业仍会处理完
+    stopping_ = true;
+}
+
+int JobServer::run() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options_.socketPath.empty() || options_.socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "套接字路径无效: " << options_.socketPath << std::endl;
+        return 2;
+    }
+    std::strncpy(address.sun_path, options_.socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(options_.socketPath.c_str()); // 上次异常退出留下的套接字文件
+    if (listenFd_ < 0 || bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd_, 64) != 0) {
+        std::cerr << "无法监听套接字: " << options_.socketPath << " (" << std::strerror(errno) << ")" << std::endl;
+        if (listenFd_ >= 0) {
+            ::close(listenFd_);
+        }
+        return 1;
+    }
+    // 客户端提前断开时send不应终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+    std::cout << "Job server listening on " << options_.socketPath << " (batch up to " << options_.maxBatch << ", window "
+              << options_.batchWindowMs << " ms)" << std::endl;
+
+    std::thread dispatcher(&JobServer::dispatch, this);
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+    std::vector<Reader> readers;
+    while (!stopping_) {
+        // 带超时等待新连接，以便及时响应shutdown
+        pollfd pending = {listenFd_, POLLIN, 0};
+        int ready = poll(&pending, 1, 200);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "等待连接失败: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (ready <= 0 || stopping_) {
+            continue;
+        }
+        int fd = accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        // 回收已断开的连接线程，长时间运行时线程数只与当前连接数有关
+        readers.erase(std::remove_if(readers.begin(), readers.end(), [](Reader& reader) {
+            if (!*reader.done) {
+                return false;
+            }
+            reader.thread.join();
+            return true;
+        }), readers.end());
+
+        auto connection = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                              [](const std::weak_ptr<Connection>& weak) { return weak.expired(); }),
+                               connections_.end());
+            connections_.push_back(connection);
+        }
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        readers.push_back({std::thread([this, connection, done]() {
+            serveConnection(connection);
+            *done = true;
+        }), done});
+    }
+    ::close(listenFd_);
+
+    // 不再接受新作业：先让排队的作业处理完并回复，再断开仍在读取的连接
+    queue_.close();
+    dispatcher.join();
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        for (auto& weak : connections_) {
+            if (auto connection = weak.lock()) {
+                connection->shutdown();
+            }
+        }
+    }
+    for (auto& reader : readers) {
+        reader.thread.join();
+    }
+    unlink(options_.socketPath.c_str());
+    std::cout << metrics_.report(0, queue_.maxQueued()) << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int runJobServer(const JobServerOptions& options) {
+    JobServer server(options);
+    return server.run();
+}
+
+#else
+
+int runJobServer(const JobServerOptions& options) {
+    std::cerr << "当前平台不支持Unix域套接字服务: " << options.socketPath << std::endl;
+    return 2;
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "jpeg_search.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+const int kSsimWindow = 11;
+const double kSsimSigma = 1.5;
+const double kSsimC1 = 6.5025;  // (0.01 * 255)^2
+const double kSsimC2 = 58.5225; // (0.03 * 255)^2
+
+void toLumaFloat(const cv::Mat& image, cv::Mat& luma) {
+    if (image.channels() == 3) {
+        cv::Mat gray;
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        gray.convertTo(luma, CV_32F);
+    } else {
+        image.convertTo(luma, CV_32F);
+    }
+}
+
+void gaussianWindow(const cv::Mat& src, cv::Mat& dst) {
+    cv::GaussianBlur(src, dst, cv::Size(kSsimWindow, kSsimWindow), kSsimSigma);
+}
+
+// 参考图像一侧的统计量只算一次，每个候选编码只需处理自己的一侧
+class SsimReference {
+public:
+    explicit SsimReference(const cv::Mat& image) {
+        toLumaFloat(image, x_);
+        gaussianWindow(x_, muX_);
+        muX2_ = muX_.mul(muX_);
+        gaussianWindow(x_.mul(x_), sigmaX2_);
+        sigmaX2_ -= muX2_;
+    }
+
+    double score(const cv::Mat& candidate) const {
+        cv::Mat y;
+        toLumaFloat(candidate, y);
+        if (y.size() != x_.size()) {
+            return -1;
+        }
+        cv::Mat muY, sigmaY2, sigmaXY;
+        gaussianWindow(y, muY);
+        cv::Mat muY2 = muY.mul(muY);
+        cv::Mat muXY = muX_.mul(muY);
+        gaussianWindow(y.mul(y), sigmaY2);
+        sigmaY2 -= muY2;
+        gaussianWindow(x_.mul(y), sigmaXY);
+        sigmaXY -= muXY;
+
+        cv::Mat numerator = (2 * muXY + kSsimC1).mul(2 * sigmaXY + kSsimC2);
+        cv::Mat denominator = (muX2_ + muY2 + kSsimC1).mul(sigmaX2_ + sigmaY2 + kSsimC2);
+        cv::Mat ssimMap;
+        cv::divide(numerator, denominator, ssimMap);
+        return cv::mean(ssimMap)[0];
+    }
+
+private:
+    cv::Mat x_;
+    cv::Mat muX_;
+    cv::Mat muX2_;
+    cv::Mat sigmaX2_;
+};
+
+struct Attempt {
+    bool done = false;
+    std::vector<uchar> data;
+    double ssim = -1;
+};
+
+class QualitySearch {
+public:
+    QualitySearch(const cv::Mat& image, const JpegSearchOptions& options)
+        : image_(image), options_(options), attempts_(101) {
+        if (options.minSsim > 0) {
+            reference_.reset(new SsimReference(image));
+        }
+        width_ = options.parallelism > 0 ? options.parallelism : std::max(1, cv::getNumThreads());
+    }
+
+    const Attempt& at(int quality) const { return attempts_[quality]; }
+    int encodes() const { return encodes_; }
+
+    // 并行编码尚未尝试过的质量；每个质量只写自己的Attempt，不需要加锁
+    void evaluate(const std::vector<int>& qualities) {
+        std::vector<int> pending;
+        for (int quality : qualities) {
+            if (!attempts_[quality].done) {
+                pending.push_back(quality);
+            }
+        }
+        cv::parallel_for_(cv::Range(0, static_cast<int>(pending.size())), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                encode(pending[i], attempts_[pending[i]]);
+            }
+        });
+        encodes_ += static_cast<int>(pending.size());
+    }
+
+    // 在[lo, hi]内寻找满足ok的边界质量。okAtLow为true时ok对低质量成立（文件大小），返回满足的最高质量，
+    // 都不满足时返回lo - 1；否则ok对高质量成立（SSIM），返回满足的最低质量，都不满足时返回hi + 1
+    int boundary(int lo, int hi, bool okAtLow, const std::function<bool(const Attempt&)>& ok) {
+        // good/bad分别是已知满足/不满足的质量，初始为区间外的哨兵
+        int good = okAtLow ? lo - 1 : hi + 1;
+        int bad = okAtLow ? hi + 1 : lo - 1;
+        while (std::abs(bad - good) > 1) {
+            const int low = std::min(good, bad);
+            const int unknown = std::abs(bad - good) - 1;
+            const int count = std::min(width_, unknown);
+            std::vector<int> probes;
+            for (int i = 1; i <= count; ++i) {
+                probes.push_back(low + (unknown + 1) * i / (count + 1));
+            }
+            evaluate(probes);
+            // 从满足的一侧向不满足的一侧走，第一个不满足的质量成为新的bad
+            if (!okAtLow) {
+                std::reverse(probes.begin(), probes.end());
+            }
+            for (int quality : probes) {
+                if (!ok(attempts_[quality])) {
+                    bad = quality;
+                    break;
+                }
+                good = quality;
+            }
+        }
+        return good;
+    }
+
+private:
+    void encode(int quality, Attempt& attempt) const {
+        TRACE_SCOPE_IMAGE("jpeg-encode", image_);
+        std::vector<int> params = {
+            cv::IMWRITE_JPEG_QUALITY, quality,
+            cv::IMWRITE_JPEG_PROGRESSIVE, options_.progressive ? 1 : 0,
+            cv::IMWRITE_JPEG_OPTIMIZE, options_.optimizeHuffman ? 1 : 0};
+        cv::imencode(".jpg", image_, attempt.data, params);
+        if (reference_) {
+            attempt.ssim = reference_->score(cv::imdecode(attempt.data, cv::IMREAD_UNCHANGED));
+        }
+        attempt.done = true;
+    }
+
+    const cv::Mat& image_;
+    const JpegSearchOptions& options_;
+    std::vector<Attempt> attempts_;
+    std::unique_ptr<SsimReference> reference_;
+    int width_ = 1;
+    int encodes_ = 0;
+};
+
+} // namespace
+
+JpegSearchResult searchJpegQuality(const cv::Mat& image, const JpegSearchOptions& options) {
+    JpegSearchResult result;
+    if (image.empty()) {
+        std::cerr << "没有可编码的图像" << std::endl;
+        return result;
+    }
+    TRACE_SCOPE_IMAGE("jpeg-search", image);
+    auto start = std::chrono::steady_clock::now();
+
+    const int lo = std::max(0, std::min(options.minQuality, 100));
+    const int hi = std::max(lo, std::min(options.maxQuality, 100));
+    QualitySearch search(image, options);
+    auto fitsSize = [&](const Attempt& attempt) { return attempt.data.size() <= options.maxBytes; };
+    auto meetsSsim = [&](const Attempt& attempt) { return attempt.ssim >= options.minSsim; };
+
+    int chosen = hi;
+    bool satisfied = true;
+    if (options.minSsim > 0) {
+        int quality = search.boundary(lo, hi, false, meetsSsim);
+        satisfied = quality <= hi;
+        chosen = satisfied ? quality : hi;
+        if (satisfied && options.maxBytes > 0 && !fitsSize(search.at(chosen))) {
+            // 满足SSIM的最小文件也超出大小上限：退回大小上限内的最高质量
+            satisfied = false;
+            chosen = std::max(lo, search.boundary(lo, hi, true, fitsSize));
+        }
+    } else if (options.maxBytes > 0) {
+        int quality = search.boundary(lo, hi, true, fitsSize);
+        satisfied = quality >= lo;
+        chosen = satisfied ? quality : lo;
+    }
+    search.evaluate({chosen});
+
+    const Attempt& best = search.at(chosen);
+    result.satisfied = satisfied;
+    result.quality = chosen;
+    result.data = best.data;
+    result.ssim = best.ssim;
+    result.encodes = search.encodes();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+double computeSsim(const cv::Mat& reference, const cv::Mat& candidate) {
+    return SsimReference(reference).score(candidate);
+}
@@ -8,16 +8,48 @@
 #include <QSlider>
 #include <QLineEdit>
 #include <QStyleFactory>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QKeySequence>
+#include <QShortcut>
+#include <QTimer>
+#include <QThreadPool>
+#include <QEvent>
+#include <QImage>
+#include <QPainter>
+#include <QWheelEvent>
+#include <QMouseEvent>
 #include <opencv2/opencv.hpp>
 #include <fstream>
+#include "buffer_pool.h"
+#include "decode_cache.h"
+#include "edit_history.h"
+#include "image_pyramid.h"
 #include "image_utils.h"
+#include "job_server.h"
+#include "jpeg_search.h"
+#include "pipeline.h"
+#include "render_worker.h"
+#include "tiled_pipeline.h"
+#include "trace.h"
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 cv::Mat currentImage;
 cv::Mat originalImage;
 cv::Mat processedImage;
+RenderWorker* renderWorker = nullptr; // 后台渲染线程（内部按阶段缓存中间结果），拖动滑块时只保留最新参数
 
 int blurValue = 0;
+BlurMethod blurMethod = BlurMethod::Exact;
 int saturationValue = 0;
 int contrastValue = 0;
 int sharpenValue = 0;
@@ -26,37 +58,292 @@ bool isResize = false;
 int resizeWidth = 100;
 int resizeHeight = 100;
 
-void displayImage(QLabel* label, const cv::Mat& image, QWidget* window) {
-    cv::Mat rgb;
-    cv::cvtColor(image, rgb, cv::COLOR_BGR2RGB);
-
-    // 获取QLabel的尺寸
-    QSize labelSize = label->size();
-    int labelWidth = labelSize.width();
-    int labelHeight = labelSize.height();
-
-    // 计算目标尺寸，保持宽高比
-    double aspectRatio = static_cast<double>(image.cols) / image.rows;
-    int targetWidth, targetHeight;
-    if (labelWidth / aspectRatio <= labelHeight) {
-        targetWidth = labelWidth;
-        targetHeight = static_cast<int>(labelWidth / aspectRatio);
-    } else {
-        targetHeight = labelHeight;
-        targetWidth = static_cast<int>(labelHeight * aspectRatio);
+bool isPreviewMode = true;  // 在与视口等大的代理图上运行处理链，保存/压缩时再渲染原图
+double previewScale = 1.0;  // 代理图相对原图的缩放比例
+cv::Size previewTarget;     // 当前代理图对应的视口尺寸
+cv::Size previewSize;       // 当前代理图尺寸
+uint64_t traceCursor = 0;   // 日志中的分阶段耗时已统计到的trace事件位置
+uint64_t poolAllocations = 0; // 上一帧显示时缓冲区池的累计新分配次数，稳定拖动时每帧应为0
+EditHistory editHistory;       // 处理参数的撤销/重做历史
+QTimer* historyCommitTimer = nullptr; // 停止调整一段时间后才把参数记入历史，拖动一次滑块只算一步
+uint64_t requestedGeneration = 0;     // 最近一次按当前参数发出的渲染请求
+uint64_t openGeneration = 0;          // 最近一次打开图像的序号，较早打开的后台解码完成时直接丢弃
+uint64_t displayedGeneration = 0;     // processedImage对应的渲染请求
+uint64_t renderSourceId = 0;          // 当前交给渲染线程的输入图像序号，其他输入上渲染的帧直接丢弃
+
+// 在全局线程池上执行work，完成后把结果交给GUI线程上的done；池中的线程在任务间复用，不随保存/打开的次数增长
+template <typename Work, typename Done>
+void runInBackground(Work work, Done done) {
+    QThreadPool::globalInstance()->start([work, done]() {
+        auto result = work();
+        QMetaObject::invokeMethod(qApp, [done, result]() { done(result); }, Qt::QueuedConnection);
+    });
+}
+
+// 监听控件尺寸变化，停止拖动窗口一段时间后再回调，避免频繁重建代理图
+class ResizeWatcher : public QObject {
+public:
+    ResizeWatcher(QObject* parent, std::function<void()> callback) : QObject(parent) {
+        timer_.setSingleShot(true);
+        timer_.setInterval(150);
+        QObject::connect(&timer_, &QTimer::timeout, this, callback);
+    }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override {
+        if (event->type() == QEvent::Resize) {
+            timer_.start();
+        }
+        return QObject::eventFilter(watched, event);
     }
 
-    // 调整图像大小以适应QLabel
-    cv::Mat resizedImage;
-    cv::resize(rgb, resizedImage, cv::Size(targetWidth, targetHeight), 0, 0, cv::INTER_AREA);
+private:
+    QTimer timer_;
+};
+
+// 显示cv::Mat的控件：图像按控件的物理像素尺寸缩放到一块常驻缓冲区，QImage以Format_BGR888直接引用它，
+// 在paintEvent中绘制。没有BGR->RGB转换，也不再经QPixmap复制；尺寸恰好相同时直接引用原图，连缩放也省去。
+// 更新时只重绘本控件。
+// 滚轮以光标为中心缩放，左键拖动平移，双击回到适应窗口。放大后从ImagePyramid中取最接近的一层，
+// 只渲染视口内的区域，每帧的代价与视口大小相当；图像更新时金字塔随之失效，用到时再按瓦片重建。
+// 显示的是预览代理图时，放大到超过代理图本身的分辨率后通过细节回调请求视口附近区域的全分辨率渲染，
+// 渲染结果交回setDetail后直接从中取视口，而不是继续放大代理图。
+class ImageView : public QWidget {
+public:
+    // 参数为需要的区域（全分辨率坐标）与请求时的帧序号，结果连同序号交给setDetail
+    using DetailHandler = std::function<void(const cv::Rect&, uint64_t)>;
+
+    explicit ImageView(const QString& placeholder, QWidget* parent = nullptr) : QWidget(parent), placeholder_(placeholder) {
+        setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding); // 扩展以适应窗口大小
+    }
 
-    QImage qimg(resizedImage.data, resizedImage.cols, resizedImage.rows, resizedImage.step, QImage::Format_RGB888);
-    label->setPixmap(QPixmap::fromImage(qimg));
-    label->setScaledContents(false); // 保持比例
+    void setDetailHandler(DetailHandler handler) { detailHandler_ = std::move(handler); }
 
-    // 调整窗口高度以适应图像高度
-    window->resize(window->width(), targetHeight + 200); // 200是按钮和日志框的高度
-}
+    // 显示image（BGR或单通道），返回适应窗口时显示区域的逻辑尺寸。
+    // image是预览代理图时，sourceSize为它对应的全分辨率尺寸，放大时据此请求全分辨率细节
+    QSize setImage(const cv::Mat& image, cv::Size sourceSize = cv::Size()) {
+        if (image.size() != pyramid_.size()) {
+            zoom_ = 0; // 尺寸变化（换图或调整尺寸）后回到适应窗口
+        }
+        image_ = image;
+        pyramid_.setImage(image);
+        sourceSize_ = sourceSize.width > image.cols ? sourceSize : cv::Size();
+        ++frameId_;
+        detail_.release(); // 细节属于上一帧
+        detailRect_ = cv::Rect();
+        requestedRect_ = cv::Rect();
+
+        // 计算目标尺寸，保持宽高比
+        double ratio = devicePixelRatioF();
+        double aspectRatio = static_cast<double>(image.cols) / image.rows;
+        int maxWidth = std::max(1, static_cast<int>(width() * ratio));
+        int maxHeight = std::max(1, static_cast<int>(height() * ratio));
+        if (maxWidth / aspectRatio <= maxHeight) {
+            fitted_ = cv::Size(maxWidth, std::max(1, static_cast<int>(maxWidth / aspectRatio)));
+        } else {
+            fitted_ = cv::Size(std::max(1, static_cast<int>(maxHeight * aspectRatio)), maxHeight);
+        }
+        render();
+        return QSize(static_cast<int>(fitted_.width / ratio), static_cast<int>(fitted_.height / ratio));
+    }
+
+    // 请求的全分辨率区域渲染完成；frame不是当前帧（期间显示了新的一帧）时丢弃
+    void setDetail(const cv::Mat& detail, const cv::Rect& rect, uint64_t frame) {
+        if (frame != frameId_ || detail.empty() || detail.size() != rect.size()) {
+            return;
+        }
+        detail_ = detail;
+        detailRect_ = rect;
+        if (zoom_ > 0) {
+            render();
+        }
+    }
+
+protected:
+    void paintEvent(QPaintEvent*) override {
+        TRACE_SCOPE("display.paint");
+        QPainter painter(this);
+        if (frame_.isNull()) {
+            painter.drawText(rect(), Qt::AlignCenter, placeholder_);
+            return;
+        }
+        // 居中显示，设置了设备像素比后按逻辑尺寸绘制即为1:1拷贝
+        painter.drawImage(QRect((width() - logicalSize_.width()) / 2, (height() - logicalSize_.height()) / 2,
+                                logicalSize_.width(), logicalSize_.height()), frame_);
+    }
+
+    void wheelEvent(QWheelEvent* event) override {
+        if (image_.empty() || event->angleDelta().y() == 0) {
+            return;
+        }
+        const double fit = fitScale();
+        const double scale = currentScale();
+        // 每格滚轮（120）缩放约1.25倍，最小为适应窗口，最大32倍
+        const double next = std::max(fit, std::min(kMaxZoom, scale * std::pow(1.25, event->angleDelta().y() / 120.0)));
+        // 保持光标下的图像点不动
+        const double ratio = devicePixelRatioF();
+        const double dx = (event->position().x() - width() / 2.0) * ratio;
+        const double dy = (event->position().y() - height() / 2.0) * ratio;
+        const cv::Point2d anchor(center().x + dx / scale, center().y + dy / scale);
+        if (next <= fit * 1.0001) {
+            zoom_ = 0;
+        } else {
+            zoom_ = next;
+            center_ = cv::Point2d(anchor.x - dx / next, anchor.y - dy / next);
+            clampCenter();
+        }
+        render();
+        event->accept();
+    }
+
+    void mousePressEvent(QMouseEvent* event) override {
+        if (event->button() == Qt::LeftButton && zoom_ > 0) {
+            dragging_ = true;
+            dragStart_ = event->position();
+            dragCenter_ = center_;
+            setCursor(Qt::ClosedHandCursor);
+        }
+    }
+
+    void mouseMoveEvent(QMouseEvent* event) override {
+        if (!dragging_) {
+            return;
+        }
+        const double scale = currentScale() / devicePixelRatioF(); // 逻辑像素/源像素
+        center_ = cv::Point2d(dragCenter_.x - (event->position().x() - dragStart_.x()) / scale,
+                              dragCenter_.y - (event->position().y() - dragStart_.y()) / scale);
+        clampCenter();
+        render();
+    }
+
+    void mouseReleaseEvent(QMouseEvent* event) override {
+        if (event->button() == Qt::LeftButton && dragging_) {
+            dragging_ = false;
+            unsetCursor();
+        }
+    }
+
+    void mouseDoubleClickEvent(QMouseEvent*) override {
+        if (zoom_ > 0) {
+            zoom_ = 0;
+            render();
+        }
+    }
+
+    // 适应窗口时由ResizeWatcher触发的setImage处理；放大时视口变化只需重新取视口内的区域
+    void resizeEvent(QResizeEvent*) override {
+        if (zoom_ > 0 && !image_.empty()) {
+            render();
+        }
+    }
+
+private:
+    static constexpr double kMaxZoom = 32.0;
+
+    // 物理像素/源像素
+    double fitScale() const {
+        return image_.empty() ? 1.0 : static_cast<double>(fitted_.width) / image_.cols;
+    }
+
+    double currentScale() const {
+        return zoom_ > 0 ? zoom_ : fitScale();
+    }
+
+    cv::Point2d center() const {
+        return zoom_ > 0 ? center_ : cv::Point2d(image_.cols / 2.0, image_.rows / 2.0);
+    }
+
+    // 图像比视口小的方向保持居中，否则不让视口移出图像
+    void clampCenter() {
+        const double ratio = devicePixelRatioF();
+        const double halfWidth = width() * ratio / zoom_ / 2.0;
+        const double halfHeight = height() * ratio / zoom_ / 2.0;
+        center_.x = halfWidth * 2 >= image_.cols ? image_.cols / 2.0 : std::max(halfWidth, std::min(image_.cols - halfWidth, center_.x));
+        center_.y = halfHeight * 2 >= image_.rows ? image_.rows / 2.0 : std::max(halfHeight, std::min(image_.rows - halfHeight, center_.y));
+    }
+
+    void render() {
+        double ratio = devicePixelRatioF();
+        if (zoom_ <= 0) {
+            if (fitted_ == image_.size()) {
+                shown_ = image_; // 预览代理图通常与控件等大，只读引用即可
+            } else {
+                TRACE_SCOPE_IMAGE("display.resize", image_);
+                cv::resize(image_, buffer_, fitted_, 0, 0, cv::INTER_AREA); // 尺寸不变时写回同一块缓冲区
+                shown_ = buffer_;
+            }
+        } else {
+            // 视口铺满整个控件，视口外的部分填窗口背景色
+            cv::Size viewport(std::max(1, static_cast<int>(width() * ratio)), std::max(1, static_cast<int>(height() * ratio)));
+            cv::Rect2d view(center_.x - viewport.width / zoom_ / 2.0, center_.y - viewport.height / zoom_ / 2.0,
+                            viewport.width / zoom_, viewport.height / zoom_);
+            QColor color = palette().color(QPalette::Window);
+            const cv::Scalar background(color.blue(), color.green(), color.red());
+            if (!renderDetail(view, viewport, background)) {
+                pyramid_.render(view, viewport, buffer_, background);
+            }
+            shown_ = buffer_;
+        }
+        QImage::Format format = shown_.channels() == 1 ? QImage::Format_Grayscale8 : QImage::Format_BGR888;
+        frame_ = QImage(shown_.data, shown_.cols, shown_.rows, shown_.step, format);
+        frame_.setDevicePixelRatio(ratio);
+        logicalSize_ = QSize(static_cast<int>(shown_.cols / ratio), static_cast<int>(shown_.rows / ratio));
+        update();
+    }
+
+    // 放大超过代理图分辨率时，视口内的图像区域（全分辨率坐标）已有细节则从细节渲染并返回true；
+    // 否则按需请求视口四周各多留半个视口的区域，平移一小段时不必重新请求
+    bool renderDetail(const cv::Rect2d& view, cv::Size viewport, const cv::Scalar& background) {
+        if (sourceSize_.empty() || zoom_ <= 1.0) {
+            return false;
+        }
+        const double toSource = static_cast<double>(sourceSize_.width) / image_.cols;
+        const cv::Rect sourceBounds(0, 0, sourceSize_.width, sourceSize_.height);
+        const cv::Rect visible = cv::Rect(cvFloor(view.x * toSource), cvFloor(view.y * toSource),
+                                          cvCeil(view.width * toSource) + 1, cvCeil(view.height * toSource) + 1) & sourceBounds;
+        if (visible.empty()) {
+            return false;
+        }
+        if ((visible & detailRect_) != visible) {
+            if (detailHandler_ && (visible & requestedRect_) != visible) {
+                requestedRect_ = cv::Rect(visible.x - visible.width / 2, visible.y - visible.height / 2,
+                                          visible.width * 2, visible.height * 2) & sourceBounds;
+                detailHandler_(requestedRect_, frameId_);
+            }
+            return false;
+        }
+        // 目标像素(u, v)的中心对应全分辨率坐标 view.x * toSource + (u + 0.5) / s，再换算为detail_内的下标；
+        // 落在detail_之外（图像范围外）的像素保留背景色
+        const double s = zoom_ / toSource; // 物理像素/全分辨率像素
+        cv::Matx23d inverse(1.0 / s, 0, view.x * toSource + 0.5 / s - 0.5 - detailRect_.x,
+                            0, 1.0 / s, view.y * toSource + 0.5 / s - 0.5 - detailRect_.y);
+        buffer_.create(viewport, detail_.type());
+        buffer_.setTo(background);
+        int interpolation = s >= 4.0 ? cv::INTER_NEAREST : cv::INTER_LINEAR;
+        cv::warpAffine(detail_, buffer_, inverse, viewport, interpolation | cv::WARP_INVERSE_MAP, cv::BORDER_TRANSPARENT);
+        return true;
+    }
+
+    QString placeholder_;
+    cv::Mat image_;       // 当前图像（只读引用）
+    ImagePyramid pyramid_;
+    cv::Size sourceSize_; // image_为预览代理图时对应的全分辨率尺寸，否则为空
+    uint64_t frameId_ = 0;
+    DetailHandler detailHandler_;
+    cv::Mat detail_;      // 当前帧在detailRect_（全分辨率坐标）内的全分辨率渲染
+    cv::Rect detailRect_;
+    cv::Rect requestedRect_; // 最近一次请求的区域，结果返回前不重复请求
+    cv::Size fitted_;     // 适应窗口时的物理像素尺寸
+    double zoom_ = 0;     // 物理像素/源像素，0表示适应窗口
+    cv::Point2d center_;  // 放大时视口中心在源图像中的坐标
+    bool dragging_ = false;
+    QPointF dragStart_;
+    cv::Point2d dragCenter_;
+    cv::Mat buffer_; // 常驻的缩放/视口缓冲区
+    cv::Mat shown_;  // 当前显示的像素（buffer_或原图的引用），frame_引用它的数据
+    QImage frame_;
+    QSize logicalSize_;
+};
 
 void logMessage(QTextEdit* log, const QString& message) {
     log->append(message);
@@ -72,78 +359,257 @@ void logMessage(QTextEdit* log, const QString& message) {
     }
 }
 
-void applyImageProcessing(QLabel* processedLabel, QWidget* window) {
+PipelineParams currentPipelineParams() {
+    PipelineParams params;
+    params.blur = blurValue;
+    params.blurMethod = blurMethod;
+    params.saturation = saturationValue;
+    params.contrast = contrastValue;
+    params.sharpen = sharpenValue;
+    params.grayscale = isGrayscale;
+    params.resize = isResize;
+    params.resizeWidth = resizeWidth;
+    params.resizeHeight = resizeHeight;
+    return params;
+}
+
+// 预览参数：模糊与锐化按代理比例换算，尺寸调整限制在代理图范围内（显示比例不变）
+PipelineParams previewPipelineParams() {
+    PipelineParams params = currentPipelineParams();
+    params.scale = previewScale;
+    if (params.resize && previewScale < 1.0) {
+        double fit = std::min({1.0, static_cast<double>(previewSize.width) / params.resizeWidth, static_cast<double>(previewSize.height) / params.resizeHeight});
+        params.resizeWidth = std::max(1, cvRound(params.resizeWidth * fit));
+        params.resizeHeight = std::max(1, cvRound(params.resizeHeight * fit));
+    }
+    return params;
+}
+
+// 按视口尺寸重建预览代理图，尺寸未变化时返回false
+bool rebuildPreviewProxy(ImageView* processedLabel) {
     if (currentImage.empty()) {
+        return false;
+    }
+
+    // 视口尺寸按128像素向上取整，避免窗口随图像高度微调时反复重建
+    cv::Size target;
+    if (isPreviewMode) {
+        double ratio = processedLabel->devicePixelRatioF();
+        target.width = (static_cast<int>(processedLabel->width() * ratio) + 127) / 128 * 128;
+        target.height = (static_cast<int>(processedLabel->height() * ratio) + 127) / 128 * 128;
+    }
+    if (target == previewTarget && !previewSize.empty()) {
+        return false;
+    }
+    previewTarget = target;
+    editHistory.dropSnapshots(); // 快照是旧代理图上的渲染结果
+
+    double scale = 1.0;
+    if (isPreviewMode) {
+        scale = std::min({1.0, static_cast<double>(target.width) / currentImage.cols, static_cast<double>(target.height) / currentImage.rows});
+    }
+    if (scale >= 1.0) {
+        previewScale = 1.0;
+        previewSize = currentImage.size();
+        renderSourceId = renderWorker->setSource(currentImage);
+    } else {
+        cv::Mat proxy;
+        cv::Size proxySize(std::max(1, cvRound(currentImage.cols * scale)), std::max(1, cvRound(currentImage.rows * scale)));
+        cv::resize(currentImage, proxy, proxySize, 0, 0, cv::INTER_AREA);
+        previewScale = static_cast<double>(proxy.cols) / currentImage.cols;
+        previewSize = proxy.size();
+        renderSourceId = renderWorker->setSource(proxy);
+    }
+    return true;
+}
+
+// 预览代理图对应的原图尺寸，放大时ImageView据此请求全分辨率细节。
+// 不是代理图或启用了尺寸调整（输出不再与原图逐像素对应）时返回空尺寸
+cv::Size detailSourceSize() {
+    return previewScale < 1.0 && !isResize ? currentImage.size() : cv::Size();
+}
+
+// 在后台按原图分辨率渲染region（原图坐标）的处理结果，交回请求它的那一帧
+void requestDetail(ImageView* processedLabel, const cv::Rect& region, uint64_t frame) {
+    if (currentImage.empty() || detailSourceSize().empty()) {
         return;
     }
+    cv::Mat source = currentImage;
+    PipelineParams params = currentPipelineParams();
+    runInBackground([source, params, region]() {
+        return applyPipelineRegion(source, params, region);
+    }, [processedLabel, region, frame](const cv::Mat& detail) {
+        processedLabel->setDetail(detail, region, frame);
+    });
+}
 
-    processedImage = currentImage.clone();
+void resetPreviewProxy(ImageView* processedLabel) {
+    previewTarget = cv::Size();
+    previewSize = cv::Size();
+    rebuildPreviewProxy(processedLabel);
+}
 
-    // 应用高斯模糊
-    if (blurValue > 0) {
-        int kernelSize = blurValue * 2 + 1; // 确保kernelSize是奇数
-        cv::GaussianBlur(processedImage, processedImage, cv::Size(kernelSize, kernelSize), 0);
+// 把当前参数交给后台渲染线程，结果在onFrameRendered中显示
+void applyImageProcessing() {
+    if (currentImage.empty()) {
+        return;
     }
 
-    // 应用饱和度
-    if (saturationValue != 0) {
-        cv::Mat hsv;
-        cv::cvtColor(processedImage, hsv, cv::COLOR_BGR2HSV);
-        std::vector<cv::Mat> channels;
-        cv::split(hsv, channels);
-        channels[1] += saturationValue;
-        cv::merge(channels, hsv);
-        cv::cvtColor(hsv, processedImage, cv::COLOR_HSV2BGR);
+    requestedGeneration = renderWorker->request(previewPipelineParams());
+    historyCommitTimer->start();
+}
+
+// 把当前参数记为一步历史（与上一步相同时忽略）
+void commitHistory() {
+    historyCommitTimer->stop();
+    editHistory.push(currentPipelineParams());
+    // 通常计时结束时这些参数的渲染结果已经显示，直接作为新关键帧的快照
+    if (editHistory.wantsSnapshot() && displayedGeneration == requestedGeneration && !processedImage.empty()) {
+        editHistory.attachSnapshot(processedImage);
     }
+}
 
-    // 应用对比度
-    if (contrastValue != 0) {
-        processedImage.convertTo(processedImage, -1, 1 + contrastValue / 50.0, 0);
+// 把上一帧以来记录的trace事件按阶段汇总后写入日志，例如 "Stages: blur 8.1 ms (3.0 MB), render 9.4 ms, ..."
+void logStageBreakdown(QTextEdit* log) {
+    std::vector<std::pair<std::string, std::pair<double, double>>> stages; // 名称 -> (毫秒, MB)，按首次出现顺序
+    for (const TraceEvent& event : traceEventsSince(traceCursor)) {
+        auto it = std::find_if(stages.begin(), stages.end(), [&](const auto& stage) { return stage.first == event.name; });
+        if (it == stages.end()) {
+            it = stages.insert(stages.end(), {event.name, {0.0, 0.0}});
+        }
+        it->second.first += event.durationNs / 1e6;
+        it->second.second += event.allocatedBytes / double(1 << 20);
+    }
+    if (stages.empty()) {
+        return;
+    }
+    QStringList parts;
+    for (const auto& stage : stages) {
+        QString part = QString("%1 %2 ms").arg(QString::fromStdString(stage.first)).arg(stage.second.first, 0, 'f', 1);
+        if (stage.second.second >= 0.05) {
+            part += QString(" (%1 MB)").arg(stage.second.second, 0, 'f', 1);
+        }
+        parts << part;
     }
+    logMessage(log, "Stages: " + parts.join(", "));
+}
 
-    // 应用锐化
-    if (sharpenValue != 0) {
-        cv::Mat kernel = (cv::Mat_<float>(3, 3) <<
-            0, -sharpenValue / 10.0, 0,
-            -sharpenValue / 10.0, 1 + 4 * sharpenValue / 10.0, -sharpenValue / 10.0,
-            0, -sharpenValue / 10.0, 0);
-        cv::filter2D(processedImage, processedImage, processedImage.depth(), kernel);
+// 在GUI线程上显示后台渲染完成的一帧，并统计从输入到显示的延迟
+void onFrameRendered(const RenderFrame& frame, ImageView* processedLabel, QLabel* latencyLabel, QTextEdit* log, QWidget* window) {
+    // 换图或重建代理图之前排队的帧来自旧的输入，不能显示，更不能作为processedImage被保存
+    if (currentImage.empty() || frame.sourceId != renderSourceId) {
+        return;
     }
 
-    // 转换为灰度图像
-    if (isGrayscale) {
-        cv::cvtColor(processedImage, processedImage, cv::COLOR_BGR2GRAY);
-        cv::cvtColor(processedImage, processedImage, cv::COLOR_GRAY2BGR); // 转换回BGR以便显示
+    processedImage = frame.image;
+    displayedGeneration = frame.generation;
+    processedLabel->setImage(processedImage, detailSourceSize());
+
+    // 渲染晚于提交历史时（或撤销/重做之后），在帧到达时为关键帧附上压缩快照，之后撤销到这里可立即显示
+    if (frame.generation == requestedGeneration && !historyCommitTimer->isActive() && editHistory.wantsSnapshot()) {
+        editHistory.attachSnapshot(frame.image);
     }
 
-    // 改变图像尺寸
-    if (isResize) {
-        cv::resize(processedImage, processedImage, cv::Size(resizeWidth, resizeHeight));
+    double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame.requestTime).count();
+    RenderWorker::Stats stats = renderWorker->stats();
+    BufferPool::Stats pool = sharedBufferPool().stats();
+    uint64_t newBuffers = pool.allocations - poolAllocations;
+    poolAllocations = pool.allocations;
+    latencyLabel->setText(QString("Input to display: %1 ms (render %2 ms), skipped %3, cancelled %4, new buffers %5 (pool %6 MB)")
+                              .arg(latencyMs, 0, 'f', 1)
+                              .arg(frame.renderMs, 0, 'f', 1)
+                              .arg(static_cast<unsigned long long>(stats.coalesced))
+                              .arg(static_cast<unsigned long long>(stats.cancelled))
+                              .arg(static_cast<unsigned long long>(newBuffers))
+                              .arg(pool.pooledBytes / double(1 << 20), 0, 'f', 1));
+    if (traceEnabled()) {
+        logStageBreakdown(log);
     }
+}
 
-    displayImage(processedLabel, processedImage, window);
+// 全分辨率图像就绪后替换预览：设置当前图像、重置历史并按当前参数渲染
+void showLoadedImage(const cv::Mat& image, ImageView* originalLabel, ImageView* processedLabel, QWidget* window) {
+    currentImage = image;
+    originalImage = currentImage; // 原图不会被原地修改，与currentImage共享像素即可
+    processedImage = currentImage.clone(); // 初始化处理后的图像
+    editHistory.reset(currentPipelineParams());
+    resetPreviewProxy(processedLabel);
+    // 调整窗口高度以适应图像高度（只在载入时调整，之后每帧只重绘图像控件）
+    QSize shown = originalLabel->setImage(currentImage);
+    window->resize(window->width(), shown.height() + 200); // 200是按钮和日志框的高度
+    applyImageProcessing();
 }
 
-void onSelectImage(QLabel* originalLabel, QLabel* processedLabel, QTextEdit* log, QWidget* window) {
-    QString fileName = QFileDialog::getOpenFileName(nullptr, "Select Image", "", "Images (*.png *.ppm *.jpg *.jpeg)");
+void logDecodeCache(QTextEdit* log, bool cacheHit) {
+    DecodeCache::Stats cacheStats = sharedDecodeCache().stats();
+    logMessage(log, QString("Decode cache %1: %2 hits, %3 misses, %4 entries (%5 of %6 MB)")
+                        .arg(cacheHit ? "hit" : "miss")
+                        .arg(static_cast<unsigned long long>(cacheStats.hits))
+                        .arg(static_cast<unsigned long long>(cacheStats.misses))
+                        .arg(static_cast<unsigned long long>(cacheStats.entries))
+                        .arg(cacheStats.bytes / double(1 << 20), 0, 'f', 1)
+                        .arg(sharedDecodeCache().sizeLimit() >> 20));
+}
+
+// 分两步打开：已缓存时直接映射缓存的像素；否则先快速解码缩小的预览立即显示，
+// 全分辨率解码在后台完成后再替换，日志中记录首次显示与全分辨率就绪的耗时
+void onSelectImage(ImageView* originalLabel, ImageView* processedLabel, QTextEdit* log, QWidget* window) {
+    QString fileName = QFileDialog::getOpenFileName(nullptr, "Select Image", "", "Images (*.png *.ppm *.pgm *.jpg *.jpeg)");
     if (fileName.isEmpty()) {
         return;
     }
-
-    currentImage = readImage(fileName.toStdString());
-    if (currentImage.empty()) {
-        logMessage(log, "Unable to open or find image");
+    const auto opened = std::chrono::steady_clock::now();
+    const std::string path = fileName.toStdString();
+    const uint64_t generation = ++openGeneration;
+
+    cv::Mat cached = sharedDecodeCache().lookup(path);
+    if (!cached.empty()) {
+        showLoadedImage(cached, originalLabel, processedLabel, window);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - opened).count();
+        logMessage(log, "Image loaded: " + fileName);
+        logMessage(log, QString("Time to first pixel: %1 ms (full resolution)").arg(ms, 0, 'f', 1));
+        logDecodeCache(log, true);
         return;
     }
 
-    originalImage = currentImage.clone(); // 保存原始图像的副本
-    processedImage = currentImage.clone(); // 初始化处理后的图像
-    displayImage(originalLabel, currentImage, window);
-    applyImageProcessing(processedLabel, window);
-    logMessage(log, "Image loaded: " + fileName);
+    int reduction = 0;
+    cv::Mat preview = readImagePreview(path, &reduction);
+    double firstPixelMs = -1;
+    if (!preview.empty()) {
+        // 全分辨率就绪前不接受编辑，也不显示上一幅图像尚未完成的渲染结果
+        currentImage.release();
+        originalImage.release();
+        processedImage.release();
+        QSize shown = originalLabel->setImage(preview);
+        processedLabel->setImage(preview);
+        window->resize(window->width(), shown.height() + 200);
+        firstPixelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - opened).count();
+        logMessage(log, QString("Preview (1/%1) shown after %2 ms, decoding full resolution...").arg(reduction).arg(firstPixelMs, 0, 'f', 1));
+    }
+
+    runInBackground([path]() {
+        bool cacheHit = false;
+        cv::Mat image = sharedDecodeCache().load(path, &cacheHit);
+        return std::make_pair(image, cacheHit);
+    }, [=](const std::pair<cv::Mat, bool>& result) {
+        if (generation != openGeneration) {
+            return; // 期间又打开了别的图像
+        }
+        if (result.first.empty()) {
+            logMessage(log, "Unable to open or find image");
+            return;
+        }
+        showLoadedImage(result.first, originalLabel, processedLabel, window);
+        double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - opened).count();
+        logMessage(log, "Image loaded: " + fileName);
+        logMessage(log, QString("Time to first pixel: %1 ms, to full resolution: %2 ms")
+                            .arg(firstPixelMs >= 0 ? firstPixelMs : fullMs, 0, 'f', 1)
+                            .arg(fullMs, 0, 'f', 1));
+        logDecodeCache(log, result.second);
+    });
 }
 
-void onConvertToGrayscale(QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onConvertToGrayscale(ImageView* processedLabel, QTextEdit* log, QWidget* window) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -151,10 +617,10 @@ void onConvertToGrayscale(QLabel* processedLabel, QTextEdit* log, QWidget* windo
 
     isGrayscale = !isGrayscale;
     logMessage(log, isGrayscale ? "Grayscale conversion enabled" : "Grayscale conversion disabled");
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
 }
 
-void onResizeImage(QLabel* processedLabel, QTextEdit* log, QWidget* window, QLineEdit* widthInput, QLineEdit* heightInput) {
+void onResizeImage(ImageView* processedLabel, QTextEdit* log, QWidget* window, QLineEdit* widthInput, QLineEdit* heightInput) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -173,65 +639,108 @@ void onResizeImage(QLabel* processedLabel, QTextEdit* log, QWidget* window, QLin
     resizeWidth = width;
     resizeHeight = height;
     logMessage(log, "Image resize set to " + QString::number(width) + "x" + QString::number(height));
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
+}
+
+// 从压缩模式控件读取JPEG搜索约束；目标值无效时返回false
+bool readCompressOptions(QComboBox* modeBox, QLineEdit* targetInput, QCheckBox* progressiveCheckBox, QCheckBox* optimizeCheckBox,
+                         QTextEdit* log, JpegSearchOptions& options) {
+    options.progressive = progressiveCheckBox->isChecked();
+    options.optimizeHuffman = optimizeCheckBox->isChecked();
+    bool ok = true;
+    if (modeBox->currentIndex() == 1) {
+        double kilobytes = targetInput->text().toDouble(&ok);
+        ok = ok && kilobytes > 0;
+        options.maxBytes = static_cast<size_t>(kilobytes * 1024);
+    } else if (modeBox->currentIndex() == 2) {
+        options.minSsim = targetInput->text().toDouble(&ok);
+        ok = ok && options.minSsim > 0 && options.minSsim <= 1;
+    }
+    if (!ok) {
+        logMessage(log, modeBox->currentIndex() == 1 ? "Invalid target size, expected kilobytes > 0" : "Invalid target SSIM, expected a value in (0, 1]");
+    }
+    return ok;
 }
 
-void onCompressImage(QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onCompressImage(ImageView* processedLabel, QTextEdit* log, QWidget* window, const JpegSearchOptions& jpegOptions) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
     }
 
-    // 获取原图像大小
-    int originalSize = currentImage.total() * currentImage.elemSize();
-
-    // 压缩图像
-    std::vector<uchar> compressedData;
-    std::vector<int> compressionParams = {cv::IMWRITE_JPEG_QUALITY, 100}; // 设置JPEG压缩质量为90
-    cv::imencode(".jpg", currentImage, compressedData, compressionParams);
-    int compressedSize = compressedData.size();
+    // 在后台渲染原图分辨率的处理结果，并在质量空间中并行搜索满足约束的编码
+    cv::Mat source = currentImage;
+    PipelineParams params = currentPipelineParams();
+    logMessage(log, "Compressing full resolution image...");
+    runInBackground([source, params, jpegOptions]() {
+        TRACE_SCOPE("compress");
+        cv::Mat result = applyPipelineTiled(source, params);
+        return std::make_pair(result.total() * result.elemSize(), searchJpegQuality(result, jpegOptions));
+    }, [log](const std::pair<size_t, JpegSearchResult>& compressed) {
+        // 获取原图像大小
+        size_t originalSize = compressed.first;
+        const JpegSearchResult& search = compressed.second;
+        const std::vector<uchar>& compressedData = search.data;
+        size_t compressedSize = compressedData.size();
+        if (compressedData.empty()) {
+            logMessage(log, "Failed to compress image");
+            return;
+        }
 
-    // 计算压缩率
-    double compressionRate = static_cast<double>(compressedSize) / originalSize * 100;
+        // 计算压缩率
+        double compressionRate = static_cast<double>(compressedSize) / originalSize * 100;
 
-    logMessage(log, "Image compressed, original size: " + QString::number(originalSize) + " bytes, compressed size: " + QString::number(compressedSize) + " bytes, compression rate: " + QString::number(compressionRate, 'f', 2) + "%");
+        QString searchInfo = "quality " + QString::number(search.quality) + ", " + QString::number(search.encodes) + " encodes in " +
+                             QString::number(search.seconds * 1000, 'f', 1) + " ms";
+        if (search.ssim >= 0) {
+            searchInfo += ", SSIM " + QString::number(search.ssim, 'f', 4);
+        }
+        if (!search.satisfied) {
+            logMessage(log, "No quality meets the target, using the closest encode");
+        }
+        logMessage(log, "Image compressed (" + searchInfo + "), original size: " + QString::number(originalSize) + " bytes, compressed size: " + QString::number(compressedSize) + " bytes, compression rate: " + QString::number(compressionRate, 'f', 2) + "%");
 
-    // 让用户选择保存压缩图像的位置
-    QString savePath = QFileDialog::getSaveFileName(nullptr, "Save Compressed Image", "", "Images (*.jpg)");
-    if (savePath.isEmpty()) {
-        return;
-    }
+        // 让用户选择保存压缩图像的位置
+        QString savePath = QFileDialog::getSaveFileName(nullptr, "Save Compressed Image", "", "Images (*.jpg)");
+        if (savePath.isEmpty()) {
+            return;
+        }
 
-    // 保存压缩后的图像
-    std::ofstream outFile(savePath.toStdString(), std::ios::binary);
-    outFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedData.size());
-    outFile.close();
+        // 保存压缩后的图像
+        std::ofstream outFile(savePath.toStdString(), std::ios::binary);
+        outFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedData.size());
+        outFile.close();
 
-    logMessage(log, "Compressed image saved to: " + savePath);
+        logMessage(log, "Compressed image saved to: " + savePath);
+    });
 }
 
 void onSaveImage(QTextEdit* log) {
-    if (processedImage.empty()) {
+    if (currentImage.empty() || processedImage.empty()) {
         logMessage(log, "No processed image to save");
         return;
     }
 
     // 让用户选择保存图像的位置
-    QString savePath = QFileDialog::getSaveFileName(nullptr, "Save Image", "", "Images (*.png *.jpg *.jpeg *.ppm)");
+    QString savePath = QFileDialog::getSaveFileName(nullptr, "Save Image", "", "Images (*.png *.jpg *.jpeg *.ppm *.pgm)");
     if (savePath.isEmpty()) {
         return;
     }
 
-    // 保存处理后的图像
-    if (savePath.endsWith(".ppm")) {
-        writePPM(savePath.toStdString(), processedImage);
-    } else {
-        cv::imwrite(savePath.toStdString(), processedImage);
-    }
-    logMessage(log, "Image saved to: " + savePath);
+    // 预览只是代理图，保存时在后台按原图分辨率分块并行重新渲染
+    cv::Mat source = currentImage;
+    PipelineParams params = currentPipelineParams();
+    std::string path = savePath.toStdString();
+    logMessage(log, "Rendering full resolution image...");
+    runInBackground([source, params, path]() {
+        TRACE_SCOPE("save");
+        return writeImage(path, applyPipelineTiled(source, params));
+    }, [log, savePath](bool saved) {
+        logMessage(log, saved ? "Image saved to: " + savePath : "Failed to save image: " + savePath);
+    });
 }
 
-void onGaussianBlur(int value, QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onGaussianBlur(int value, ImageView* processedLabel, QTextEdit* log, QWidget* window) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -239,10 +748,10 @@ void onGaussianBlur(int value, QLabel* processedLabel, QTextEdit* log, QWidget*
 
     blurValue = value;
     logMessage(log, "Gaussian blur intensity set to " + QString::number(value * 5) + "%");
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
 }
 
-void onSaturationChange(int value, QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onSaturationChange(int value, ImageView* processedLabel, QTextEdit* log, QWidget* window) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -250,10 +759,10 @@ void onSaturationChange(int value, QLabel* processedLabel, QTextEdit* log, QWidg
 
     saturationValue = value;
     logMessage(log, "Saturation set to " + QString::number(value));
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
 }
 
-void onContrastChange(int value, QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onContrastChange(int value, ImageView* processedLabel, QTextEdit* log, QWidget* window) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -261,10 +770,10 @@ void onContrastChange(int value, QLabel* processedLabel, QTextEdit* log, QWidget
 
     contrastValue = value;
     logMessage(log, "Contrast set to " + QString::number(value));
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
 }
 
-void onSharpenChange(int value, QLabel* processedLabel, QTextEdit* log, QWidget* window) {
+void onSharpenChange(int value, ImageView* processedLabel, QTextEdit* log, QWidget* window) {
     if (currentImage.empty()) {
         logMessage(log, "Please select an image first");
         return;
@@ -272,10 +781,10 @@ void onSharpenChange(int value, QLabel* processedLabel, QTextEdit* log, QWidget*
 
     sharpenValue = value;
     logMessage(log, "Sharpen set to " + QString::number(value));
-    applyImageProcessing(processedLabel, window);
+    applyImageProcessing();
 }
 
-void onRestoreImage(QLabel* processedLabel, QTextEdit* log, QWidget* window, QSlider* blurSlider, QSlider* saturationSlider, QSlider* contrastSlider, QSlider* sharpenSlider, QLineEdit* widthInput, QLineEdit* heightInput) {
+void onRestoreImage(ImageView* processedLabel, QTextEdit* log, QWidget* window, QSlider* blurSlider, QSlider* saturationSlider, QSlider* contrastSlider, QSlider* sharpenSlider, QLineEdit* widthInput, QLineEdit* heightInput) {
     if (originalImage.empty()) {
         logMessage(log, "No original image to restore");
         return;
@@ -302,11 +811,86 @@ void onRestoreImage(QLabel* processedLabel, QTextEdit* log, QWidget* window, QSl
 
     currentImage = originalImage.clone();
     processedImage = originalImage.clone();
-    applyImageProcessing(processedLabel, window);
+    resetPreviewProxy(processedLabel);
+    applyImageProcessing();
     logMessage(log, "Image restored to original");
 }
 
+void onUndoRedo(bool redo, ImageView* processedLabel, QTextEdit* log, QSlider* blurSlider, QComboBox* blurMethodBox, QSlider* saturationSlider, QSlider* contrastSlider, QSlider* sharpenSlider, QLineEdit* widthInput, QLineEdit* heightInput) {
+    if (currentImage.empty()) {
+        logMessage(log, "Please select an image first");
+        return;
+    }
+
+    commitHistory(); // 先记下尚未提交的调整
+    PipelineParams params;
+    cv::Mat snapshot;
+    bool moved = redo ? editHistory.redo(params, &snapshot) : editHistory.undo(params, &snapshot);
+    if (!moved) {
+        logMessage(log, redo ? "Nothing to redo" : "Nothing to undo");
+        return;
+    }
+
+    // 恢复参数并同步控件（控件的信号会再设置一次相同的值，记入历史时与当前步骤相同而被忽略）
+    blurValue = params.blur;
+    blurMethod = params.blurMethod;
+    saturationValue = params.saturation;
+    contrastValue = params.contrast;
+    sharpenValue = params.sharpen;
+    isGrayscale = params.grayscale;
+    isResize = params.resize;
+    resizeWidth = params.resizeWidth;
+    resizeHeight = params.resizeHeight;
+    blurSlider->setValue(params.blur);
+    blurMethodBox->setCurrentIndex(static_cast<int>(params.blurMethod));
+    saturationSlider->setValue(params.saturation);
+    contrastSlider->setValue(params.contrast);
+    sharpenSlider->setValue(params.sharpen);
+    widthInput->setText(QString::number(params.resizeWidth));
+    heightInput->setText(QString::number(params.resizeHeight));
+
+    if (!snapshot.empty()) {
+        processedLabel->setImage(snapshot, detailSourceSize()); // 关键帧快照，渲染完成前先显示
+    }
+    applyImageProcessing();
+    historyCommitTimer->stop();
+
+    EditHistory::Stats stats = editHistory.stats();
+    logMessage(log, QString("%1: step %2 of %3 (history %4 KB, %5 snapshots)")
+                        .arg(redo ? "Redo" : "Undo")
+                        .arg(static_cast<unsigned long long>(stats.position + 1))
+                        .arg(static_cast<unsigned long long>(stats.steps))
+                        .arg(stats.memoryUsage / 1024.0, 0, 'f', 1)
+                        .arg(static_cast<unsigned long long>(stats.snapshots)));
+}
+
+// 服务模式：ImageProcessing --serve <socket> [--max-batch <n>] [--batch-window <ms>] [--max-queued <n>]
+// 不创建任何界面对象，见job_server.h中的协议说明
+int runServeMode(int argc, char** argv) {
+    JobServerOptions options;
+    options.socketPath = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = i + 1 < argc ? argv[++i] : std::string();
+        if (arg == "--max-batch") {
+            options.maxBatch = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--batch-window") {
+            options.batchWindowMs = std::max(0.0, std::atof(value.c_str()));
+        } else if (arg == "--max-queued") {
+            options.maxQueued = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " --serve <socket> [--max-batch <n>] [--batch-window <ms>] [--max-queued <n>]" << std::endl;
+            return 2;
+        }
+    }
+    return runJobServer(options);
+}
+
 int main(int argc, char** argv) {
+    if (argc >= 3 && std::string(argv[1]) == "--serve") {
+        return runServeMode(argc, argv);
+    }
+
     QApplication app(argc, argv);
 
     // 设置macOS风格
@@ -368,6 +952,8 @@ int main(int argc, char** argv) {
     QPushButton* compressButton = new QPushButton("Compress Image");
     QPushButton* restoreButton = new QPushButton("Restore Image");
     QPushButton* saveButton = new QPushButton("Save Image");
+    QPushButton* undoButton = new QPushButton("Undo");
+    QPushButton* redoButton = new QPushButton("Redo");
 
     buttonLayout->addWidget(selectButton);
     buttonLayout->addWidget(grayscaleButton);
@@ -375,6 +961,8 @@ int main(int argc, char** argv) {
     buttonLayout->addWidget(compressButton);
     buttonLayout->addWidget(restoreButton);
     buttonLayout->addWidget(saveButton);
+    buttonLayout->addWidget(undoButton);
+    buttonLayout->addWidget(redoButton);
 
     QHBoxLayout* resizeLayout = new QHBoxLayout();
     QLabel* widthLabel = new QLabel("Width:");
@@ -387,14 +975,32 @@ int main(int argc, char** argv) {
     resizeLayout->addWidget(widthInput);
     resizeLayout->addWidget(heightLabel);
     resizeLayout->addWidget(heightInput);
+    QCheckBox* previewCheckBox = new QCheckBox("Fast Preview");
+    previewCheckBox->setChecked(isPreviewMode); // 默认开启视口分辨率预览
+    resizeLayout->addWidget(previewCheckBox);
+    QCheckBox* traceCheckBox = new QCheckBox("Trace Stages");
+    QPushButton* exportTraceButton = new QPushButton("Export Trace");
+    resizeLayout->addWidget(traceCheckBox);
+    resizeLayout->addWidget(exportTraceButton);
+
+    // 压缩模式：固定质量100，或在质量空间中搜索不超过目标大小 / 不低于目标SSIM的编码
+    QHBoxLayout* compressLayout = new QHBoxLayout();
+    QComboBox* compressModeBox = new QComboBox();
+    compressModeBox->addItems({"Quality 100", "Max size (KB)", "Min SSIM"});
+    QLineEdit* compressTargetInput = new QLineEdit();
+    compressTargetInput->setPlaceholderText("Target");
+    compressTargetInput->setEnabled(false);
+    QCheckBox* progressiveCheckBox = new QCheckBox("Progressive");
+    QCheckBox* optimizeCheckBox = new QCheckBox("Optimize Huffman");
+    compressLayout->addWidget(new QLabel("Compress:"));
+    compressLayout->addWidget(compressModeBox);
+    compressLayout->addWidget(compressTargetInput);
+    compressLayout->addWidget(progressiveCheckBox);
+    compressLayout->addWidget(optimizeCheckBox);
 
     QHBoxLayout* imageLayout = new QHBoxLayout();
-    QLabel* originalLabel = new QLabel("Original Image");
-    QLabel* processedLabel = new QLabel("Processed Image");
-    originalLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding); // 使标签扩展以适应窗口大小
-    originalLabel->setAlignment(Qt::AlignCenter); // 居中显示图像
-    processedLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding); // 使标签扩展以适应窗口大小
-    processedLabel->setAlignment(Qt::AlignCenter); // 居中显示图像
+    ImageView* originalLabel = new ImageView("Original Image");
+    ImageView* processedLabel = new ImageView("Processed Image");
 
     imageLayout->addWidget(originalLabel);
     imageLayout->addWidget(processedLabel);
@@ -406,8 +1012,11 @@ int main(int argc, char** argv) {
     blurSlider->setRange(0, 20); // 设置滑块范围
     blurSlider->setValue(0); // 初始值为0
     QLabel* blurLabel = new QLabel("Gaussian Blur Intensity: 0%");
+    QComboBox* blurMethodBox = new QComboBox();
+    blurMethodBox->addItems({"Exact", "Box (fast)", "Recursive (fast)"}); // 顺序与BlurMethod一致
     blurLayout->addWidget(blurLabel);
     blurLayout->addWidget(blurSlider);
+    blurLayout->addWidget(blurMethodBox);
 
     QVBoxLayout* saturationLayout = new QVBoxLayout();
     QSlider* saturationSlider = new QSlider(Qt::Horizontal);
@@ -438,27 +1047,67 @@ int main(int argc, char** argv) {
     sliderLayout->addLayout(contrastLayout);
     sliderLayout->addLayout(sharpenLayout);
 
+    QLabel* latencyLabel = new QLabel("Input to display: -");
+
     QTextEdit* log = new QTextEdit();
     log->setReadOnly(true); // 设置日志为只读
     log->setMaximumHeight(100); // 限制日志框的最大高度
 
     mainLayout->addLayout(buttonLayout);
     mainLayout->addLayout(resizeLayout);
+    mainLayout->addLayout(compressLayout);
     mainLayout->addLayout(sliderLayout);
     mainLayout->addLayout(imageLayout);
+    mainLayout->addWidget(latencyLabel);
     mainLayout->addWidget(log);
 
+    // 渲染完成的帧从工作线程投递回GUI线程显示
+    RenderWorker worker([&](const RenderFrame& frame) {
+        QMetaObject::invokeMethod(qApp, [&, frame]() { onFrameRendered(frame, processedLabel, latencyLabel, log, &window); }, Qt::QueuedConnection);
+    });
+    renderWorker = &worker;
+    processedLabel->setDetailHandler([processedLabel](const cv::Rect& region, uint64_t frame) { requestDetail(processedLabel, region, frame); });
+
     QObject::connect(selectButton, &QPushButton::clicked, [&]() { onSelectImage(originalLabel, processedLabel, log, &window); });
     QObject::connect(grayscaleButton, &QPushButton::clicked, [&]() { onConvertToGrayscale(processedLabel, log, &window); });
     QObject::connect(resizeButton, &QPushButton::clicked, [&]() { onResizeImage(processedLabel, log, &window, widthInput, heightInput); });
-    QObject::connect(compressButton, &QPushButton::clicked, [&]() { onCompressImage(processedLabel, log, &window); });
+    QObject::connect(compressButton, &QPushButton::clicked, [&]() {
+        JpegSearchOptions jpegOptions;
+        if (readCompressOptions(compressModeBox, compressTargetInput, progressiveCheckBox, optimizeCheckBox, log, jpegOptions)) {
+            onCompressImage(processedLabel, log, &window, jpegOptions);
+        }
+    });
+    QObject::connect(compressModeBox, &QComboBox::currentIndexChanged, [&](int index) {
+        compressTargetInput->setEnabled(index != 0);
+        compressTargetInput->setText(index == 1 ? "200" : index == 2 ? "0.95" : "");
+    });
     QObject::connect(restoreButton, &QPushButton::clicked, [&]() { onRestoreImage(processedLabel, log, &window, blurSlider, saturationSlider, contrastSlider, sharpenSlider, widthInput, heightInput); });
     QObject::connect(saveButton, &QPushButton::clicked, [&]() { onSaveImage(log); });
+
+    // 参数停止变化500毫秒后记入历史
+    QTimer commitTimer;
+    commitTimer.setSingleShot(true);
+    commitTimer.setInterval(500);
+    historyCommitTimer = &commitTimer;
+    QObject::connect(&commitTimer, &QTimer::timeout, []() { commitHistory(); });
+    auto undo = [&]() { onUndoRedo(false, processedLabel, log, blurSlider, blurMethodBox, saturationSlider, contrastSlider, sharpenSlider, widthInput, heightInput); };
+    auto redo = [&]() { onUndoRedo(true, processedLabel, log, blurSlider, blurMethodBox, saturationSlider, contrastSlider, sharpenSlider, widthInput, heightInput); };
+    QObject::connect(undoButton, &QPushButton::clicked, undo);
+    QObject::connect(redoButton, &QPushButton::clicked, redo);
+    QObject::connect(new QShortcut(QKeySequence::Undo, &window), &QShortcut::activated, undo);
+    QObject::connect(new QShortcut(QKeySequence::Redo, &window), &QShortcut::activated, redo);
     QObject::connect(blurSlider, &QSlider::valueChanged, [&]() {
         int value = blurSlider->value();
         blurLabel->setText(QString("Gaussian Blur Intensity: %1%").arg(value * 5)); // 假设最大值为100%
         onGaussianBlur(value, processedLabel, log, &window);
     });
+    QObject::connect(blurMethodBox, &QComboBox::currentIndexChanged, [&](int index) {
+        blurMethod = static_cast<BlurMethod>(index);
+        logMessage(log, "Blur method set to " + blurMethodBox->currentText());
+        if (!currentImage.empty() && blurValue > 0) {
+            applyImageProcessing();
+        }
+    });
     QObject::connect(saturationSlider, &QSlider::valueChanged, [&]() {
         int value = saturationSlider->value();
         saturationLabel->setText(QString("Saturation: %1").arg(value));
@@ -474,6 +1123,40 @@ int main(int argc, char** argv) {
         sharpenLabel->setText(QString("Sharpen: %1").arg(value));
         onSharpenChange(value, processedLabel, log, &window);
     });
+    QObject::connect(previewCheckBox, &QCheckBox::toggled, [&](bool checked) {
+        isPreviewMode = checked;
+        logMessage(log, checked ? "Fast preview enabled" : "Fast preview disabled");
+        if (!currentImage.empty()) {
+            resetPreviewProxy(processedLabel);
+            applyImageProcessing();
+        }
+    });
+    QObject::connect(traceCheckBox, &QCheckBox::toggled, [&](bool checked) {
+        setTraceEnabled(checked);
+        uint64_t latest = traceCursor;
+        traceEventsSince(latest); // 只统计开启之后的事件
+        traceCursor = latest;
+        logMessage(log, checked ? "Stage tracing enabled" : "Stage tracing disabled");
+    });
+    QObject::connect(exportTraceButton, &QPushButton::clicked, [&]() {
+        QString tracePath = QFileDialog::getSaveFileName(nullptr, "Export Trace", "trace.json", "Chrome Trace (*.json)");
+        if (tracePath.isEmpty()) {
+            return;
+        }
+        bool written = writeChromeTrace(tracePath.toStdString());
+        logMessage(log, written ? "Trace written to: " + tracePath + " (open in chrome://tracing)" : "Failed to write trace: " + tracePath);
+    });
+
+    // 窗口尺寸变化后按新的视口重建预览代理图
+    processedLabel->installEventFilter(new ResizeWatcher(processedLabel, [&]() {
+        if (rebuildPreviewProxy(processedLabel)) {
+            applyImageProcessing();
+        }
+    }));
+
+    // 退出前等待后台保存/压缩任务结束
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { QThreadPool::globalInstance()->waitForDone(); });
+
     window.setLayout(mainLayout);
     window.show();
 
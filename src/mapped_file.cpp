@@ -0,0 +1,123 @@
+#include "mapped_file.h"
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        writable_ = other.writable_;
+        buffer_ = std::move(other.buffer_);
+        if (!mapped_ && !buffer_.empty()) {
+            data_ = buffer_.data();
+        }
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+        other.writable_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path, bool copyOnWrite) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), protection, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后即可关闭文件描述符
+    if (addr != MAP_FAILED) {
+        // 图像数据基本是顺序扫描，提示内核预读
+        madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const unsigned char*>(addr);
+        size_ = static_cast<size_t>(st.st_size);
+        mapped_ = true;
+        writable_ = copyOnWrite;
+        return true;
+    }
+#endif
+
+    // 回退：整体读入内存
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamsize length = file.tellg();
+    if (length <= 0) {
+        return false;
+    }
+    buffer_.resize(static_cast<size_t>(length));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer_.data()), length)) {
+        buffer_.clear();
+        return false;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    writable_ = true; // 堆缓冲区本身就是私有副本
+    return true;
+}
+
+size_t MappedFile::discard(size_t offset, size_t length) {
+#ifndef _WIN32
+    if (!mapped_ || offset >= size_) {
+        return offset;
+    }
+    // madvise要求起始地址按页对齐，只释放完整落在范围内的页
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(size_, offset + length) / page * page;
+    if (end > begin) {
+        madvise(const_cast<unsigned char*>(data_) + begin, end - begin, MADV_DONTNEED);
+        return end;
+    }
+#else
+    (void)length;
+#endif
+    return offset;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped_ && data_) {
+        munmap(const_cast<unsigned char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    writable_ = false;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+}
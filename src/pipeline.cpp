@@ -0,0 +1,262 @@
+#include "pipeline.h"
+#include "color_kernels.h"
+#include "fused_pipeline.h"
+#include "trace.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// 核较小时精确路径本身就很快，而盒式/递归近似在sigma < 2时误差明显，此时仍用cv::GaussianBlur
+bool usesFastBlur(int blur, double scale, BlurMethod method) {
+    return method != BlurMethod::Exact && gaussianSigmaForKernel(blur * 2 + 1) * scale >= 2.0;
+}
+
+void copyIfDistinct(const cv::Mat& src, cv::Mat& dst) {
+    if (src.data != dst.data) {
+        src.copyTo(dst);
+    }
+}
+
+} // namespace
+
+void applyBlurStage(const cv::Mat& src, cv::Mat& dst, int blur, double scale, BlurMethod method, bool serial) {
+    // 应用高斯模糊
+    if (blur <= 0) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("blur", src);
+    int kernelSize = blur * 2 + 1; // 确保kernelSize是奇数
+    if (usesFastBlur(blur, scale, method)) {
+        fastGaussianBlur(src, dst, gaussianSigmaForKernel(kernelSize) * scale, method, serial);
+        return;
+    }
+    if (scale == 1.0) {
+        cv::GaussianBlur(src, dst, cv::Size(kernelSize, kernelSize), 0);
+        return;
+    }
+    // 缩小的图像上按比例缩小sigma与核大小（sigma公式同cv::getGaussianKernel）
+    double sigma = gaussianSigmaForKernel(kernelSize) * scale;
+    int scaledSize = std::max(1, cvRound(kernelSize * scale)) | 1;
+    if (scaledSize > 1) {
+        cv::GaussianBlur(src, dst, cv::Size(scaledSize, scaledSize), sigma);
+    } else {
+        copyIfDistinct(src, dst);
+    }
+}
+
+void applySaturationStage(const cv::Mat& src, cv::Mat& dst, int saturation) {
+    // 应用饱和度
+    if (saturation == 0) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("saturation", src);
+    ColorOps ops;
+    ops.saturation = saturation;
+    applyColorOps(src, dst, ops);
+}
+
+void applyContrastStage(const cv::Mat& src, cv::Mat& dst, int contrast) {
+    // 应用对比度
+    if (contrast == 0) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("contrast", src);
+    ColorOps ops;
+    ops.contrast = contrast;
+    applyColorOps(src, dst, ops);
+}
+
+void applySharpenStage(const cv::Mat& src, cv::Mat& dst, int sharpen, double scale) {
+    // 应用锐化
+    if (sharpen == 0) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("sharpen", src);
+    float edge, center;
+    sharpenCoefficients(sharpen, scale, edge, center);
+    float coefficients[9] = {
+        0, edge, 0,
+        edge, center, edge,
+        0, edge, 0};
+    cv::Mat kernel(3, 3, CV_32F, coefficients); // 引用栈上的系数，不分配内存
+    cv::filter2D(src, dst, src.depth(), kernel);
+}
+
+void sharpenCoefficients(int sharpen, double scale, float& edge, float& center) {
+    // 缩小scale倍后拉普拉斯响应约放大1/scale²倍，按scale²减弱以保持观感一致
+    double e = scale == 1.0 ? -sharpen / 10.0 : -sharpen / 10.0 * scale * scale;
+    double c = scale == 1.0 ? 1 + 4 * sharpen / 10.0 : 1 - 4 * e;
+    edge = static_cast<float>(e);
+    center = static_cast<float>(c);
+}
+
+void applyGrayscaleStage(const cv::Mat& src, cv::Mat& dst, bool grayscale) {
+    // 转换为单通道灰度图像，之后的阶段、显示与保存都只处理一个通道
+    if (!grayscale || src.channels() == 1) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("grayscale", src);
+    cv::cvtColor(src, dst, cv::COLOR_BGR2GRAY);
+}
+
+void applyResizeStage(const cv::Mat& src, cv::Mat& dst, bool resize, int width, int height) {
+    // 改变图像尺寸
+    if (!resize) {
+        copyIfDistinct(src, dst);
+        return;
+    }
+    TRACE_SCOPE_IMAGE("resize", src);
+    cv::resize(src, dst, cv::Size(width, height));
+}
+
+cv::Mat applyPipeline(const cv::Mat& image, const PipelineParams& params) {
+    if (image.empty()) {
+        return cv::Mat();
+    }
+
+    TRACE_SCOPE_IMAGE("pipeline", image);
+    cv::Mat result = image.clone();
+    applyFilterStages(result, params);
+    applyResizeStage(result, result, params.resize, params.resizeWidth, params.resizeHeight);
+    return result;
+}
+
+void applyFilterStages(cv::Mat& image, const PipelineParams& params, bool serial) {
+    applyBlurStage(image, image, params.blur, params.scale, params.blurMethod, serial);
+
+    // 饱和度、对比度都是逐像素运算，合并为一次遍历；灰度放在最后单独转换为单通道
+    ColorOps ops;
+    ops.saturation = params.saturation;
+    ops.contrast = params.contrast;
+    // 烘焙为3D LUT后每像素代价固定，与叠加的颜色运算个数无关；导入的调色表也并入同一张表
+    int lutSize = params.lutSize > 0 ? params.lutSize : (params.grading ? params.grading->size() : 0);
+    bool useLut = lutSize > 0 && image.depth() == CV_8U && (ops.any() || params.grading);
+    // 不查表时，颜色、锐化与灰度由按启用组合特化的融合内核一次完成
+    if (!useLut && applyFusedStages(image, image, params, serial)) {
+        return;
+    }
+    if (useLut && image.channels() == 1 && params.grading) {
+        cv::cvtColor(image, image, cv::COLOR_GRAY2BGR); // 调色表可能给灰度图着色，展开为BGR后查表
+    }
+    if (useLut && image.type() == CV_8UC3) {
+        TRACE_SCOPE_IMAGE("color-lut", image);
+        compileColorLUT(ops, lutSize, params.grading)->apply(image, image, serial);
+    } else if (ops.any()) {
+        TRACE_SCOPE_IMAGE("color", image);
+        applyColorOps(image, image, ops, serial);
+    }
+    applySharpenStage(image, image, params.sharpen, params.scale);
+    applyGrayscaleStage(image, image, params.grayscale);
+}
+
+int pipelineHaloRows(const PipelineParams& params) {
+    int halo = 0;
+    if (params.blur > 0 && usesFastBlur(params.blur, params.scale, params.blurMethod)) {
+        halo += blurSupportRadius(gaussianSigmaForKernel(params.blur * 2 + 1) * params.scale, params.blurMethod);
+    } else if (params.blur > 0) {
+        // 与applyBlurStage的核大小保持一致
+        int kernelSize = params.blur * 2 + 1;
+        if (params.scale != 1.0) {
+            kernelSize = std::max(1, cvRound(kernelSize * params.scale)) | 1;
+        }
+        halo += kernelSize / 2;
+    }
+    if (params.sharpen != 0) {
+        halo += 1; // 3x3锐化核
+    }
+    return halo;
+}
+
+namespace {
+
+bool parseInt(const std::string& text, int minValue, int maxValue, int& value) {
+    try {
+        size_t used = 0;
+        int v = std::stoi(text, &used);
+        if (used != text.size() || v < minValue || v > maxValue) {
+            return false;
+        }
+        value = v;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace
+
+bool parsePipelineSpec(const std::string& spec, PipelineParams& params, std::string* error) {
+    PipelineParams parsed;
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        bool ok = true;
+        if (key == "blur") {
+            ok = parseInt(value, 0, 20, parsed.blur);
+        } else if (key == "blurmethod") {
+            ok = parseBlurMethod(value, parsed.blurMethod);
+        } else if (key == "saturation") {
+            ok = parseInt(value, -100, 100, parsed.saturation);
+        } else if (key == "contrast") {
+            ok = parseInt(value, -100, 100, parsed.contrast);
+        } else if (key == "sharpen") {
+            ok = parseInt(value, 0, 20, parsed.sharpen);
+        } else if (key == "grayscale") {
+            parsed.grayscale = value.empty() || value == "1" || value == "true";
+            ok = value.empty() || value == "1" || value == "true" || value == "0" || value == "false";
+        } else if (key == "lut") {
+            ok = parseInt(value, 2, ColorLUT3D::kMaxSize, parsed.lutSize);
+        } else if (key == "resize") {
+            size_t x = value.find('x');
+            ok = x != std::string::npos &&
+                 parseInt(value.substr(0, x), 1, 1 << 16, parsed.resizeWidth) &&
+                 parseInt(value.substr(x + 1), 1, 1 << 16, parsed.resizeHeight);
+            parsed.resize = ok;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (error) {
+                *error = "Invalid pipeline item: " + item;
+            }
+            return false;
+        }
+    }
+    params = parsed;
+    return true;
+}
+
+std::string formatPipelineSpec(const PipelineParams& params) {
+    std::ostringstream out;
+    out << "blur=" << params.blur;
+    if (params.blurMethod != BlurMethod::Exact) {
+        out << ",blurmethod=" << blurMethodName(params.blurMethod);
+    }
+    out << ",saturation=" << params.saturation
+        << ",contrast=" << params.contrast
+        << ",sharpen=" << params.sharpen;
+    if (params.grayscale) {
+        out << ",grayscale";
+    }
+    if (params.lutSize > 0) {
+        out << ",lut=" << params.lutSize;
+    }
+    if (params.resize) {
+        out << ",resize=" << params.resizeWidth << "x" << params.resizeHeight;
+    }
+    return out.str();
+}
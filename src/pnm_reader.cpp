@@ -0,0 +1,266 @@
+#include "pnm_reader.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+inline bool isPNMSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// 跳过空白与'#'开头的注释行
+inline size_t skipSpaceAndComments(const unsigned char* data, size_t size, size_t pos) {
+    while (pos < size) {
+        if (isPNMSpace(data[pos])) {
+            ++pos;
+        } else if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n' && data[pos] != '\r') {
+                ++pos;
+            }
+        } else {
+            break;
+        }
+    }
+    return pos;
+}
+
+inline bool readUnsigned(const unsigned char* data, size_t size, size_t& pos, int& value) {
+    pos = skipSpaceAndComments(data, size, pos);
+    if (pos >= size || data[pos] < '0' || data[pos] > '9') {
+        return false;
+    }
+    long long v = 0;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+        v = v * 10 + (data[pos] - '0');
+        if (v > 0x7fffffff) {
+            return false;
+        }
+        ++pos;
+    }
+    value = static_cast<int>(v);
+    return true;
+}
+
+// 逐个读取样本并缩放到目标位深的范围
+class SampleScaler {
+public:
+    SampleScaler(int maxval, int dstDepth) : maxval_(maxval) {
+        int dstMax = dstDepth == CV_16U ? 65535 : 255;
+        identity_ = maxval == dstMax;
+        if (maxval <= 255) {
+            lut_.resize(256);
+            for (int v = 0; v < 256; ++v) {
+                int c = std::min(v, maxval);
+                lut_[v] = static_cast<unsigned short>((c * dstMax + maxval / 2) / maxval);
+            }
+        }
+        toEight_ = maxval > 255 && dstDepth == CV_8U;
+    }
+
+    inline unsigned short operator()(int v) const {
+        if (v > maxval_) {
+            v = maxval_;
+        }
+        if (!lut_.empty()) {
+            return lut_[v];
+        }
+        // 16位样本：先缩放到0..65535，再按需截取高8位（与cv::imread处理16位图像一致）
+        unsigned int full = identity_ ? static_cast<unsigned int>(v)
+                                      : static_cast<unsigned int>((static_cast<unsigned long long>(v) * 65535 + maxval_ / 2) / maxval_);
+        return static_cast<unsigned short>(toEight_ ? full >> 8 : full);
+    }
+
+    bool identity() const { return identity_; }
+
+private:
+    int maxval_;
+    bool identity_ = false;
+    bool toEight_ = false;
+    std::vector<unsigned short> lut_;
+};
+
+// 把一行按文件顺序排列的样本写到输出行，同时完成RGB->BGR交换或灰度扩展
+template <typename T>
+inline void emitRow(const T* src, T* dst, int width, int srcChannels, int dstChannels) {
+    if (srcChannels == 1 && dstChannels == 1) {
+        std::memcpy(dst, src, static_cast<size_t>(width) * sizeof(T));
+    } else if (srcChannels == 1) {
+        for (int x = 0; x < width; ++x) {
+            dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = src[x];
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            dst[3 * x] = src[3 * x + 2];
+            dst[3 * x + 1] = src[3 * x + 1];
+            dst[3 * x + 2] = src[3 * x];
+        }
+    }
+}
+
+template <typename T>
+bool decodeRows(const unsigned char* data, size_t size, const PNMHeader& header, size_t& pos, const SampleScaler& scale, cv::Mat& dst) {
+    const int width = header.width;
+    const int srcChannels = header.channels;
+    const int dstChannels = dst.channels();
+    const size_t rowSamples = static_cast<size_t>(width) * srcChannels;
+    std::vector<T> row(rowSamples);
+
+    if (header.binary) {
+        const int bytesPerSample = header.maxval > 255 ? 2 : 1;
+        const size_t rowBytes = rowSamples * bytesPerSample;
+        if (pos > size || (size - pos) / rowBytes < static_cast<size_t>(dst.rows)) {
+            return false;
+        }
+        const unsigned char* src = data + pos;
+        pos += rowBytes * dst.rows;
+        for (int y = 0; y < dst.rows; ++y, src += rowBytes) {
+            const T* samples;
+            if (bytesPerSample == 1 && scale.identity()) {
+                // 8位满量程数据可直接使用映射内存，无需中间缓冲
+                samples = reinterpret_cast<const T*>(src);
+            } else {
+                for (size_t i = 0; i < rowSamples; ++i) {
+                    int v = bytesPerSample == 1 ? src[i] : (src[2 * i] << 8) | src[2 * i + 1]; // 大端
+                    row[i] = static_cast<T>(scale(v));
+                }
+                samples = row.data();
+            }
+            emitRow(samples, dst.ptr<T>(y), width, srcChannels, dstChannels);
+        }
+    } else {
+        for (int y = 0; y < dst.rows; ++y) {
+            for (size_t i = 0; i < rowSamples; ++i) {
+                int v;
+                if (!readUnsigned(data, size, pos, v)) {
+                    return false;
+                }
+                row[i] = static_cast<T>(scale(v));
+            }
+            emitRow(row.data(), dst.ptr<T>(y), width, srcChannels, dstChannels);
+        }
+    }
+    return true;
+}
+
+// 文件头声明的尺寸需要的最少像素数据字节数是否不超过available；
+// ASCII格式每个样本至少一位数字加一个分隔符，乘法按除法比较以免size_t溢出
+bool payloadFits(const PNMHeader& header, size_t available) {
+    const size_t bytesPerSample = header.binary ? (header.maxval > 255 ? 2 : 1) : 2;
+    const size_t rowBytes = static_cast<size_t>(header.width) * header.channels * bytesPerSample;
+    if (rowBytes / bytesPerSample / header.channels != static_cast<size_t>(header.width)) {
+        return false;
+    }
+    size_t limit = available;
+    if (!header.binary) {
+        ++limit; // 最后一个样本之后可以没有分隔符
+    }
+    return limit / rowBytes >= static_cast<size_t>(header.height);
+}
+
+} // namespace
+
+bool parsePNMHeader(const unsigned char* data, size_t size, PNMHeader& header) {
+    if (size < 3 || data[0] != 'P') {
+        return false;
+    }
+    header = PNMHeader();
+    header.format = static_cast<char>(data[1]);
+    switch (header.format) {
+    case '2': header.channels = 1; header.binary = false; break;
+    case '3': header.channels = 3; header.binary = false; break;
+    case '5': header.channels = 1; header.binary = true; break;
+    case '6': header.channels = 3; header.binary = true; break;
+    default: return false;
+    }
+
+    size_t pos = 2;
+    if (!readUnsigned(data, size, pos, header.width) ||
+        !readUnsigned(data, size, pos, header.height) ||
+        !readUnsigned(data, size, pos, header.maxval)) {
+        return false;
+    }
+    if (header.width <= 0 || header.height <= 0 || header.maxval <= 0 || header.maxval > 65535) {
+        return false;
+    }
+    // maxval之后紧跟一个空白字符，随后即为像素数据
+    if (pos >= size || !isPNMSpace(data[pos])) {
+        return false;
+    }
+    header.dataOffset = pos + 1;
+    return true;
+}
+
+bool decodePNMRows(const unsigned char* data, size_t size, const PNMHeader& header, size_t& pos, cv::Mat& dst) {
+    if (dst.cols != header.width || (dst.channels() != header.channels && dst.channels() != 3)) {
+        return false;
+    }
+    SampleScaler scale(header.maxval, dst.depth());
+    return dst.depth() == CV_16U ? decodeRows<unsigned short>(data, size, header, pos, scale, dst)
+                                 : decodeRows<unsigned char>(data, size, header, pos, scale, dst);
+}
+
+cv::Mat decodePNM(const unsigned char* data, size_t size, int flags) {
+    PNMHeader header;
+    if (!parsePNMHeader(data, size, header)) {
+        std::cerr << "无法解析PNM文件头" << std::endl;
+        return cv::Mat();
+    }
+
+    // 先确认数据量与文件头一致再分配输出，截断或伪造的文件头不会触发巨大的分配
+    if (!payloadFits(header, size - header.dataOffset)) {
+        std::cerr << "PNM像素数据不完整" << std::endl;
+        return cv::Mat();
+    }
+
+    int dstDepth = (flags == cv::IMREAD_UNCHANGED && header.maxval > 255) ? CV_16U : CV_8U;
+    int dstChannels = flags == cv::IMREAD_COLOR ? 3 : header.channels;
+    cv::Mat image(header.height, header.width, CV_MAKETYPE(dstDepth, dstChannels));
+
+    size_t pos = header.dataOffset;
+    if (!decodePNMRows(data, size, header, pos, image)) {
+        std::cerr << "PNM像素数据不完整" << std::endl;
+        return cv::Mat();
+    }
+
+    if (flags == cv::IMREAD_GRAYSCALE && image.channels() == 3) {
+        cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+    }
+    return image;
+}
+
+cv::Mat readPNM(const std::string& path, int flags) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cerr << "无法打开PNM文件: " << path << std::endl;
+        return cv::Mat();
+    }
+    return decodePNM(file.data(), file.size(), flags);
+}
+
+bool PNMView::open(const std::string& path) {
+    if (!file_.open(path)) {
+        return false;
+    }
+    if (!parsePNMHeader(file_.data(), file_.size(), header_)) {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+bool PNMView::canWrap() const {
+    if (!file_.isOpen() || !header_.binary || header_.maxval != 255) {
+        return false;
+    }
+    return payloadFits(header_, file_.size() - header_.dataOffset);
+}
+
+cv::Mat PNMView::image() const {
+    if (!canWrap()) {
+        return cv::Mat();
+    }
+    // cv::Mat不持有映射内存，只是对其包装（只读访问）
+    unsigned char* payload = const_cast<unsigned char*>(file_.data() + header_.dataOffset);
+    return cv::Mat(header_.height, header_.width, CV_8UC(header_.channels), payload);
+}
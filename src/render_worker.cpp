@@ -0,0 +1,107 @@
+#include "render_worker.h"
+#include "trace.h"
+
+RenderWorker::RenderWorker(FrameCallback onFrame) : onFrame_(std::move(onFrame)) {
+    thread_ = std::thread(&RenderWorker::run, this);
+}
+
+RenderWorker::~RenderWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ++latestGeneration_; // 让正在进行的渲染尽快退出
+    wake_.notify_all();
+    thread_.join();
+}
+
+uint64_t RenderWorker::setSource(const cv::Mat& source) {
+    uint64_t sourceId;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingSource_ = source;
+        hasSource_ = true;
+        sourceId = ++pendingSourceId_;
+        ++latestGeneration_;
+    }
+    wake_.notify_one();
+    return sourceId;
+}
+
+uint64_t RenderWorker::request(const PipelineParams& params) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hasRequest_) {
+            ++stats_.coalesced;
+        }
+        ++stats_.requests;
+        pendingParams_ = params;
+        pendingTime_ = std::chrono::steady_clock::now();
+        hasRequest_ = true;
+        generation = ++latestGeneration_;
+    }
+    wake_.notify_one();
+    return generation;
+}
+
+RenderWorker::Stats RenderWorker::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void RenderWorker::run() {
+    PipelineParams params;
+    bool haveParams = false;
+    uint64_t sourceId = 0;
+
+    for (;;) {
+        RenderFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || hasRequest_ || hasSource_; });
+            if (stopping_) {
+                return;
+            }
+            if (hasSource_) {
+                pipeline_.setSource(pendingSource_);
+                pendingSource_ = cv::Mat();
+                sourceId = pendingSourceId_;
+                hasSource_ = false;
+            }
+            if (hasRequest_) {
+                params = pendingParams_;
+                frame.requestTime = pendingTime_;
+                hasRequest_ = false;
+                haveParams = true;
+            } else if (!haveParams) {
+                continue;
+            } else {
+                // 只换了输入图像，沿用上一组参数重新渲染
+                frame.requestTime = std::chrono::steady_clock::now();
+            }
+            frame.generation = latestGeneration_;
+            frame.sourceId = sourceId;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            TRACE_SCOPE("render");
+            frame.image = pipeline_.render(params, [&]() { return latestGeneration_ != frame.generation; });
+        }
+        frame.renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (latestGeneration_ != frame.generation) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.cancelled;
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.rendered;
+        }
+        if (!frame.image.empty()) {
+            onFrame_(frame);
+        }
+    }
+}
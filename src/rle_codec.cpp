@@ -0,0 +1,302 @@
+#include "rle_codec.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uchar kMagic[4] = {'R', 'L', 'E', 'I'};
+const int kVersion = 1;
+const size_t kHeaderSize = 16;
+// 与cv::imread默认的CV_IO_MAX_IMAGE_PIXELS相同，文件头声明更大的尺寸时不分配直接拒绝
+const uint64_t kMaxPixels = uint64_t(1) << 30;
+
+inline void putU16(uchar* p, uint32_t v) {
+    p[0] = static_cast<uchar>(v);
+    p[1] = static_cast<uchar>(v >> 8);
+}
+
+inline void putU32(uchar* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uchar>(v >> (8 * i));
+    }
+}
+
+inline void putU64(uchar* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uchar>(v >> (8 * i));
+    }
+}
+
+inline uint32_t getU32(const uchar* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline uint64_t getU64(const uchar* p) {
+    return static_cast<uint64_t>(getU32(p)) | static_cast<uint64_t>(getU32(p + 4)) << 32;
+}
+
+inline uchar* putVarint(uchar* p, size_t v) {
+    while (v >= 0x80) {
+        *p++ = static_cast<uchar>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<uchar>(v);
+    return p;
+}
+
+inline size_t varintLength(size_t v) {
+    size_t length = 1;
+    for (; v >= 0x80; v >>= 7) {
+        ++length;
+    }
+    return length;
+}
+
+inline bool getVarint(const uchar*& p, const uchar* end, size_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uchar b = *p++;
+        v |= static_cast<size_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 从p开始满足 p[j] == p[j + stride] 的最长前缀（最多limit个字节）。
+// 按像素比较相当于比较相隔一个像素的字节，因此任意通道数都可以整块向量比较。
+inline size_t matchingPrefix(const uchar* p, size_t stride, size_t limit) {
+    size_t j = 0;
+#if defined(__SSE2__)
+    for (; j + 16 <= limit; j += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j + stride));
+        unsigned mismatch = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) & 0xffffu;
+        if (mismatch) {
+            return j + __builtin_ctz(mismatch);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; j + 16 <= limit; j += 16) {
+        uint64x2_t eq = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(p + j), vld1q_u8(p + j + stride)));
+        uint64_t lo = ~vgetq_lane_u64(eq, 0);
+        uint64_t hi = ~vgetq_lane_u64(eq, 1);
+        if (lo) {
+            return j + __builtin_ctzll(lo) / 8;
+        }
+        if (hi) {
+            return j + 8 + __builtin_ctzll(hi) / 8;
+        }
+    }
+#endif
+    while (j < limit && p[j] == p[j + stride]) {
+        ++j;
+    }
+    return j;
+}
+
+// 从p开始与第一个像素相同的连续像素数（至少为1）
+inline size_t runLength(const uchar* p, size_t pixels, int channels) {
+    if (pixels < 2 || std::memcmp(p, p + channels, channels) != 0) {
+        return 1; // 原样段里大多数像素与下一个不同，先做一次标量判断
+    }
+    return matchingPrefix(p, channels, (pixels - 1) * channels) / channels + 1;
+}
+
+// 编码一行，返回写入的字节数；dst至少需要 2 * 行字节数 + 16 的空间
+size_t encodeRow(const uchar* row, size_t width, int channels, uchar* dst) {
+    // 单通道时2个像素的重复段不比原样段省空间
+    const size_t minRun = channels == 1 ? 3 : 2;
+    uchar* out = dst;
+    size_t literalStart = 0;
+    auto flushLiteral = [&](size_t end) {
+        if (end > literalStart) {
+            size_t bytes = (end - literalStart) * channels;
+            out = putVarint(out, (end - literalStart - 1) << 1);
+            std::memcpy(out, row + literalStart * channels, bytes);
+            out += bytes;
+        }
+    };
+
+    size_t x = 0;
+    while (x < width) {
+        size_t run = runLength(row + x * channels, width - x, channels);
+        if (run >= minRun) {
+            flushLiteral(x);
+            out = putVarint(out, (run - 1) << 1 | 1);
+            std::memcpy(out, row + x * channels, channels);
+            out += channels;
+            literalStart = x + run;
+        }
+        x += run;
+    }
+    flushLiteral(width);
+    return static_cast<size_t>(out - dst);
+}
+
+bool decodeRow(const uchar* src, const uchar* srcEnd, uchar* dst, size_t rowBytes, int channels) {
+    uchar* const dstEnd = dst + rowBytes;
+    while (dst < dstEnd) {
+        size_t token;
+        if (!getVarint(src, srcEnd, token)) {
+            return false;
+        }
+        size_t pixels = (token >> 1) + 1;
+        if (pixels > static_cast<size_t>(dstEnd - dst) / channels) {
+            return false;
+        }
+        size_t bytes = pixels * channels;
+        if (token & 1) {
+            if (static_cast<size_t>(srcEnd - src) < static_cast<size_t>(channels)) {
+                return false;
+            }
+            if (channels == 1) {
+                std::memset(dst, *src, bytes);
+            } else {
+                // 先写一个像素，再成倍复制已写出的部分
+                std::memcpy(dst, src, channels);
+                for (size_t filled = channels; filled < bytes;) {
+                    size_t chunk = std::min(filled, bytes - filled);
+                    std::memcpy(dst + filled, dst, chunk);
+                    filled += chunk;
+                }
+            }
+            src += channels;
+        } else {
+            if (static_cast<size_t>(srcEnd - src) < bytes) {
+                return false;
+            }
+            std::memcpy(dst, src, bytes);
+            src += bytes;
+        }
+        dst += bytes;
+    }
+    return src == srcEnd;
+}
+
+} // namespace
+
+std::vector<uchar> encodeRLE(const cv::Mat& image) {
+    if (image.empty() || image.depth() != CV_8U || image.channels() > 4) {
+        std::cerr << "RLE编码仅支持1~4通道的8位图像" << std::endl;
+        return std::vector<uchar>();
+    }
+    const int channels = image.channels();
+    const size_t width = static_cast<size_t>(image.cols);
+    const size_t height = static_cast<size_t>(image.rows);
+    const size_t rowBound = 2 * width * channels + 16;
+
+    // 各行先编码到互不重叠的临时区域，再按顺序拼接
+    std::unique_ptr<uchar[]> scratch(new uchar[rowBound * height]);
+    std::vector<size_t> lengths(height);
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            lengths[y] = encodeRow(image.ptr<uchar>(y), width, channels, scratch.get() + rowBound * y);
+        }
+    });
+
+    const size_t tableSize = 8 * (height + 1);
+    size_t payload = 0;
+    for (size_t length : lengths) {
+        payload += length;
+    }
+    std::vector<uchar> encoded(kHeaderSize + tableSize + payload);
+    uchar* header = encoded.data();
+    std::memcpy(header, kMagic, 4);
+    header[4] = static_cast<uchar>(kVersion);
+    header[5] = static_cast<uchar>(channels);
+    putU16(header + 6, 0);
+    putU32(header + 8, static_cast<uint32_t>(width));
+    putU32(header + 12, static_cast<uint32_t>(height));
+
+    uchar* table = header + kHeaderSize;
+    uchar* out = table + tableSize;
+    size_t offset = 0;
+    for (size_t y = 0; y < height; ++y) {
+        putU64(table + 8 * y, offset);
+        std::memcpy(out + offset, scratch.get() + rowBound * y, lengths[y]);
+        offset += lengths[y];
+    }
+    putU64(table + 8 * height, offset);
+    return encoded;
+}
+
+bool isRLEData(const uchar* data, size_t size) {
+    return size >= kHeaderSize && std::memcmp(data, kMagic, 4) == 0;
+}
+
+cv::Mat decodeRLE(const uchar* data, size_t size) {
+    if (!isRLEData(data, size) || data[4] != kVersion) {
+        std::cerr << "不是有效的RLE数据" << std::endl;
+        return cv::Mat();
+    }
+    const int channels = data[5];
+    const uint32_t width = getU32(data + 8);
+    const uint32_t height = getU32(data + 12);
+    if (channels < 1 || channels > 4 || width == 0 || height == 0 || width > 0x7fffffff / 4 || height > 0x7fffffff ||
+        static_cast<uint64_t>(width) * height > kMaxPixels) {
+        std::cerr << "RLE文件头无效" << std::endl;
+        return cv::Mat();
+    }
+    const size_t tableSize = 8 * (static_cast<size_t>(height) + 1);
+    if ((size - kHeaderSize) / 8 < static_cast<size_t>(height) + 1) {
+        std::cerr << "RLE数据不完整" << std::endl;
+        return cv::Mat();
+    }
+    const uchar* table = data + kHeaderSize;
+    const uchar* payload = table + tableSize;
+    const size_t payloadSize = size - kHeaderSize - tableSize;
+    if (getU64(table + 8 * static_cast<size_t>(height)) != payloadSize) {
+        std::cerr << "RLE数据不完整" << std::endl;
+        return cv::Mat();
+    }
+    // 分配之前先确认行表与尺寸相符：每行至少是一个覆盖整行的重复段（记号头加一个像素），
+    // 否则文件头声明的尺寸与数据量不符
+    const size_t minRowBytes = varintLength((static_cast<size_t>(width) - 1) << 1 | 1) + channels;
+    if (payloadSize / minRowBytes < height) {
+        std::cerr << "RLE数据不完整" << std::endl;
+        return cv::Mat();
+    }
+    for (size_t y = 0; y < height; ++y) {
+        uint64_t begin = getU64(table + 8 * y);
+        uint64_t end = getU64(table + 8 * (y + 1));
+        if (begin > end || end > payloadSize || end - begin < minRowBytes) {
+            std::cerr << "RLE数据损坏" << std::endl;
+            return cv::Mat();
+        }
+    }
+
+    cv::Mat image(static_cast<int>(height), static_cast<int>(width), CV_8UC(channels));
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    std::atomic<bool> ok{true};
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end && ok.load(std::memory_order_relaxed); ++y) {
+            uint64_t begin = getU64(table + 8 * static_cast<size_t>(y));
+            uint64_t end = getU64(table + 8 * static_cast<size_t>(y + 1));
+            if (!decodeRow(payload + begin, payload + end, image.ptr<uchar>(y), rowBytes, channels)) {
+                ok = false;
+            }
+        }
+    });
+    if (!ok) {
+        std::cerr << "RLE数据损坏" << std::endl;
+        return cv::Mat();
+    }
+    return image;
+}
+
+cv::Mat decodeRLE(const std::vector<uchar>& data) {
+    return decodeRLE(data.data(), data.size());
+}
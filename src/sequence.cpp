@@ -0,0 +1,349 @@
+#include "sequence.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "image_utils.h"
+#include "spsc_queue.h"
+#include "trace.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = lowerExtension(path.string());
+    return ext == "png" || ext == "ppm" || ext == "pgm" || ext == "pnm" || ext == "jpg" || ext == "jpeg" || ext == "rle";
+}
+
+// 调用前已由isFrameIndexPattern检查过格式，snprintf只会看到一个整数转换
+std::string formatFrameIndex(const std::string& pattern, int index) {
+    std::vector<char> buffer(pattern.size() + 32);
+    std::snprintf(buffer.data(), buffer.size(), pattern.c_str(), index);
+    return buffer.data();
+}
+
+struct Frame {
+    int index = -1;
+    cv::Mat image;
+};
+
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+    // 读取下一帧；没有更多帧时返回false
+    virtual bool read(cv::Mat& frame) = 0;
+    virtual bool failed() const { return false; }
+    virtual int firstIndex() const { return 0; }
+    virtual double fps() const { return 0; }
+};
+
+// 编号图像序列或目录中的图像，逐个用readImage解码
+class FileSequenceSource : public FrameSource {
+public:
+    FileSequenceSource(std::vector<std::string> paths, int firstIndex) : paths_(std::move(paths)), firstIndex_(firstIndex) {}
+
+    bool read(cv::Mat& frame) override {
+        if (next_ >= paths_.size() || failed_) {
+            return false;
+        }
+        frame = readImage(paths_[next_]);
+        if (frame.empty()) {
+            std::cerr << "无法读取帧: " << paths_[next_] << std::endl;
+            failed_ = true;
+            return false;
+        }
+        ++next_;
+        return true;
+    }
+    bool failed() const override { return failed_; }
+    int firstIndex() const override { return firstIndex_; }
+
+private:
+    std::vector<std::string> paths_;
+    int firstIndex_;
+    size_t next_ = 0;
+    bool failed_ = false;
+};
+
+class VideoSource : public FrameSource {
+public:
+    bool open(const std::string& path) { return capture_.open(path) && capture_.isOpened(); }
+    bool read(cv::Mat& frame) override { return capture_.read(frame) && !frame.empty(); }
+    double fps() const override { return capture_.get(cv::CAP_PROP_FPS); }
+
+private:
+    cv::VideoCapture capture_;
+};
+
+std::unique_ptr<FrameSource> openFrameSource(const std::string& input) {
+    std::vector<std::string> paths;
+    int first = 0;
+    std::error_code ec;
+    if (isFrameIndexPattern(input)) {
+        first = fs::exists(formatFrameIndex(input, 0), ec) ? 0 : 1;
+        for (int i = first; fs::exists(formatFrameIndex(input, i), ec); ++i) {
+            paths.push_back(formatFrameIndex(input, i));
+        }
+    } else if (fs::is_directory(input, ec)) {
+        for (const auto& entry : fs::directory_iterator(input, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                paths.push_back(entry.path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+    } else {
+        auto video = std::make_unique<VideoSource>();
+        if (!video->open(input)) {
+            return nullptr;
+        }
+        return video;
+    }
+    if (paths.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<FileSequenceSource>(std::move(paths), first);
+}
+
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    virtual bool write(const cv::Mat& frame, int index) = 0;
+    virtual bool finish() { return true; }
+};
+
+class FileSequenceSink : public FrameSink {
+public:
+    explicit FileSequenceSink(const std::string& pattern) : pattern_(pattern) {}
+    bool write(const cv::Mat& frame, int index) override { return writeImage(formatFrameIndex(pattern_, index), frame); }
+
+private:
+    std::string pattern_;
+};
+
+// 第一帧到达时才知道尺寸，此时再打开cv::VideoWriter
+class VideoSink : public FrameSink {
+public:
+    VideoSink(const std::string& path, double fps) : path_(path), fps_(fps) {}
+
+    bool write(const cv::Mat& frame, int) override {
+        if (!writer_.isOpened()) {
+            const int fourcc = lowerExtension(path_) == "avi" ? cv::VideoWriter::fourcc('M', 'J', 'P', 'G')
+                                                                : cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+            size_ = frame.size();
+            if (!writer_.open(path_, fourcc, fps_, size_, true)) {
+                std::cerr << "无法创建视频文件: " << path_ << std::endl;
+                return false;
+            }
+        }
+        if (frame.size() != size_) {
+            std::cerr << "帧尺寸与视频不一致: " << path_ << std::endl;
+            return false;
+        }
+        if (frame.channels() == 1) {
+            // 各后端对单通道视频的支持不一，统一展开为BGR
+            cv::cvtColor(frame, gray_, cv::COLOR_GRAY2BGR);
+            writer_.write(gray_);
+        } else {
+            writer_.write(frame);
+        }
+        return true;
+    }
+
+    bool finish() override {
+        writer_.release();
+        return true;
+    }
+
+private:
+    std::string path_;
+    double fps_;
+    cv::Size size_;
+    cv::VideoWriter writer_;
+    cv::Mat gray_;
+};
+
+} // namespace
+
+bool isFrameIndexPattern(const std::string& path) {
+    int conversions = 0;
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (path[i] != '%') {
+            continue;
+        }
+        if (i + 1 < path.size() && path[i + 1] == '%') {
+            ++i;
+            continue;
+        }
+        size_t j = i + 1;
+        while (j < path.size() && std::isdigit(static_cast<unsigned char>(path[j]))) {
+            ++j;
+        }
+        if (j >= path.size() || path[j] != 'd' || j - i > 3) {
+            return false; // 只接受 %d 与 %0Nd（N至多两位）
+        }
+        ++conversions;
+        i = j;
+    }
+    return conversions == 1;
+}
+
+bool processSequence(const std::string& input, const std::string& output, const PipelineParams& params,
+                     const SequenceOptions& options, SequenceStats* stats) {
+    const Clock::time_point start = Clock::now();
+    std::unique_ptr<FrameSource> source = openFrameSource(input);
+    if (!source) {
+        std::cerr << "无法打开帧序列或视频: " << input << std::endl;
+        return false;
+    }
+    std::unique_ptr<FrameSink> sink;
+    if (isFrameIndexPattern(output)) {
+        sink = std::make_unique<FileSequenceSink>(output);
+    } else {
+        double fps = options.fps > 0 ? options.fps : (source->fps() > 0 ? source->fps() : 25.0);
+        sink = std::make_unique<VideoSink>(output, fps);
+    }
+
+    const int workers = options.workers > 0 ? options.workers : std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 2);
+    std::vector<std::unique_ptr<SpscQueue<Frame>>> toProcess;
+    std::vector<std::unique_ptr<SpscQueue<Frame>>> toEncode;
+    for (int k = 0; k < workers; ++k) {
+        toProcess.emplace_back(new SpscQueue<Frame>(options.queueDepth));
+        toEncode.emplace_back(new SpscQueue<Frame>(options.queueDepth));
+    }
+    auto closeAll = [&]() {
+        for (int k = 0; k < workers; ++k) {
+            toProcess[k]->close();
+            toEncode[k]->close();
+        }
+    };
+
+    // 解码：按顺序读取，第i帧放入第 i % workers 个处理队列
+    SequenceStats local;
+    local.workers = workers;
+    std::thread decoder([&]() {
+        for (int i = 0; options.maxFrames <= 0 || i < options.maxFrames; ++i) {
+            Frame frame;
+            frame.index = i;
+            Clock::time_point readStart = Clock::now();
+            {
+                TRACE_SCOPE("sequence.decode");
+                if (!source->read(frame.image)) {
+                    break;
+                }
+            }
+            local.decodeSeconds += secondsSince(readStart);
+            Clock::time_point pushStart = Clock::now();
+            if (!toProcess[i % workers]->push(std::move(frame))) {
+                break; // 编码端出错后关闭了队列
+            }
+            local.decodeStallSeconds += secondsSince(pushStart);
+        }
+        for (auto& queue : toProcess) {
+            queue->close();
+        }
+    });
+
+    // 处理：每个线程只读写自己的一对队列，两端都是单生产者单消费者。
+    // 处理抛出异常时记下错误并关闭自己的两个队列：解码端随后push失败而停止，编码端取到这里时结束
+    std::vector<double> processSeconds(workers, 0.0);
+    std::vector<std::string> processErrors(workers);
+    std::vector<std::thread> processors;
+    for (int k = 0; k < workers; ++k) {
+        processors.emplace_back([&, k]() {
+            Frame frame;
+            while (toProcess[k]->pop(frame)) {
+                Clock::time_point processStart = Clock::now();
+                try {
+                    TRACE_SCOPE_IMAGE("sequence.process", frame.image);
+                    frame.image = applyPipeline(frame.image, params);
+                } catch (const std::exception& e) {
+                    processErrors[k] = "第" + std::to_string(source->firstIndex() + frame.index) + "帧: " + e.what();
+                    toProcess[k]->close();
+                    break;
+                }
+                processSeconds[k] += secondsSince(processStart);
+                if (!toEncode[k]->push(std::move(frame))) {
+                    break;
+                }
+            }
+            toEncode[k]->close();
+        });
+    }
+
+    // 编码在调用线程上进行：按帧号轮流从各处理线程取结果，某个队列关闭且取空即表示没有更多帧
+    bool ok = true;
+    double inputSamples = 0;
+    double outputSamples = 0;
+    const double queueCapacity = static_cast<double>(workers) * toProcess[0]->capacity();
+    for (int i = 0;; ++i) {
+        Frame frame;
+        Clock::time_point waitStart = Clock::now();
+        if (!toEncode[i % workers]->pop(frame)) {
+            break;
+        }
+        local.encodeWaitSeconds += secondsSince(waitStart);
+
+        size_t queued = 0;
+        size_t finished = 0;
+        for (int k = 0; k < workers; ++k) {
+            queued += toProcess[k]->size();
+            finished += toEncode[k]->size();
+        }
+        inputSamples += queued / queueCapacity;
+        outputSamples += finished / queueCapacity;
+
+        Clock::time_point encodeStart = Clock::now();
+        TRACE_SCOPE_IMAGE("sequence.encode", frame.image);
+        if (!sink->write(frame.image, source->firstIndex() + frame.index)) {
+            std::cerr << "写入帧失败: " << output << std::endl;
+            ok = false;
+            closeAll(); // 让解码与处理线程尽快退出
+            break;
+        }
+        local.encodeSeconds += secondsSince(encodeStart);
+        ++local.frames;
+    }
+    // 某个处理线程出错而提前结束时，其余线程可能还阻塞在已无人读取的队列上
+    closeAll();
+    decoder.join();
+    for (auto& thread : processors) {
+        thread.join();
+    }
+    for (const std::string& error : processErrors) {
+        if (!error.empty()) {
+            std::cerr << "处理帧失败，" << error << std::endl;
+            ok = false;
+        }
+    }
+    ok = sink->finish() && ok && !source->failed();
+    if (local.frames == 0) {
+        std::cerr << "没有读到任何帧: " << input << std::endl;
+        ok = false;
+    }
+
+    for (double seconds : processSeconds) {
+        local.processSeconds += seconds;
+    }
+    if (local.frames > 0) {
+        local.inputOccupancy = inputSamples / local.frames;
+        local.outputOccupancy = outputSamples / local.frames;
+    }
+    local.seconds = secondsSince(start);
+    if (stats) {
+        *stats = local;
+    }
+    return ok;
+}
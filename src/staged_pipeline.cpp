@@ -0,0 +1,151 @@
+#include "staged_pipeline.h"
+#include "buffer_pool.h"
+
+StagedPipeline::StagedPipeline(size_t memoryBudget) : budget_(memoryBudget) {}
+
+void StagedPipeline::setSource(const cv::Mat& image) {
+    clear();
+    source_ = image;
+}
+
+void StagedPipeline::clear() {
+    entries_.clear();
+    lru_.clear();
+    usage_ = 0;
+}
+
+void StagedPipeline::setMemoryBudget(size_t bytes) {
+    budget_ = bytes;
+    evictToBudget();
+}
+
+StagedPipeline::StageKey StagedPipeline::keyForStage(const PipelineParams& params, int stage) {
+    // 之后的阶段一律记为中性值；中性阶段不改变图像，因此与前一阶段共用同一个键
+    StageKey key = {0, 0, 0, 0, 0, 0, 0, 0};
+    if (stage >= Blur) {
+        key[0] = params.blur;
+        key[1] = params.blur > 0 ? static_cast<int>(params.blurMethod) : 0;
+    }
+    if (stage >= Saturation) key[2] = params.saturation;
+    if (stage >= Contrast) key[3] = params.contrast;
+    if (stage >= Sharpen) key[4] = params.sharpen;
+    if (stage >= Grayscale) key[5] = params.grayscale ? 1 : 0;
+    if (stage >= Resize && params.resize) {
+        key[6] = params.resizeWidth;
+        key[7] = params.resizeHeight;
+    }
+    return key;
+}
+
+void StagedPipeline::runStage(int stage, const cv::Mat& src, cv::Mat& dst, const PipelineParams& params) {
+    switch (stage) {
+    case Blur: applyBlurStage(src, dst, params.blur, params.scale, params.blurMethod); break;
+    case Saturation: applySaturationStage(src, dst, params.saturation); break;
+    case Contrast: applyContrastStage(src, dst, params.contrast); break;
+    case Sharpen: applySharpenStage(src, dst, params.sharpen, params.scale); break;
+    case Grayscale: applyGrayscaleStage(src, dst, params.grayscale); break;
+    case Resize: applyResizeStage(src, dst, params.resize, params.resizeWidth, params.resizeHeight); break;
+    default: break;
+    }
+}
+
+cv::Mat StagedPipeline::render(const PipelineParams& params, const std::function<bool()>& cancelled) {
+    if (source_.empty()) {
+        return cv::Mat();
+    }
+
+    const StageKey sourceKey = keyForStage(params, -1);
+    std::array<StageKey, StageCount> keys;
+    for (int stage = 0; stage < StageCount; ++stage) {
+        keys[stage] = keyForStage(params, stage);
+    }
+
+    // 从最后一个阶段往前找第一个已缓存（或等于原图）的结果
+    int first = 0;
+    cv::Mat current = source_;
+    for (int stage = StageCount - 1; stage >= 0; --stage) {
+        if (keys[stage] == sourceKey) {
+            first = stage + 1;
+            break;
+        }
+        auto it = entries_.find(keys[stage]);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            current = it->second.image;
+            first = stage + 1;
+            break;
+        }
+    }
+
+    stats_.lastFirstStage = first;
+    if (first == StageCount) {
+        ++stats_.hits;
+        return current;
+    }
+
+    for (int stage = first; stage < StageCount; ++stage) {
+        if (keys[stage] == (stage == 0 ? sourceKey : keys[stage - 1])) {
+            continue; // 中性阶段，输出与输入相同
+        }
+        if (cancelled && cancelled()) {
+            return cv::Mat();
+        }
+        // 输出缓冲区从池中借用：先淘汰本阶段多余的旧结果，它的缓冲区（界面已不再引用时）随即回到池中被复用
+        evictStageVariants(stage, kVariantsPerStage - 1);
+        cv::Size size = stage == Resize ? cv::Size(params.resizeWidth, params.resizeHeight) : current.size();
+        int type = stage == Grayscale ? CV_MAKETYPE(current.depth(), 1) : current.type();
+        cv::Mat next = sharedBufferPool().acquire(size, type);
+        runStage(stage, current, next, params);
+        ++stats_.stagesComputed;
+        insert(keys[stage], next, stage);
+        current = next;
+    }
+    return current;
+}
+
+void StagedPipeline::insert(const StageKey& key, const cv::Mat& image, int stage) {
+    size_t bytes = image.total() * image.elemSize();
+    if (bytes > budget_) {
+        return; // 单个结果已超出上限，不缓存
+    }
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        usage_ -= it->second.bytes;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+    lru_.push_front(key);
+    Entry& entry = entries_[key];
+    entry.image = image;
+    entry.bytes = bytes;
+    entry.stage = stage;
+    entry.lru = lru_.begin();
+    usage_ += bytes;
+    evictToBudget();
+}
+
+void StagedPipeline::evictStageVariants(int stage, int keep) {
+    // 从最近使用的一端数起，本阶段超过keep个之后的结果全部淘汰
+    int kept = 0;
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        auto entry = entries_.find(*it);
+        if (entry->second.stage != stage || kept++ < keep) {
+            ++it;
+            continue;
+        }
+        usage_ -= entry->second.bytes;
+        entries_.erase(entry);
+        it = lru_.erase(it);
+        ++stats_.evictions;
+    }
+}
+
+void StagedPipeline::evictToBudget() {
+    while (usage_ > budget_ && !lru_.empty()) {
+        auto it = entries_.find(lru_.back());
+        usage_ -= it->second.bytes;
+        entries_.erase(it);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
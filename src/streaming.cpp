@@ -0,0 +1,209 @@
+#include "streaming.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "strip_io.h"
+
+namespace {
+
+// 流式尺寸调整：每个条带先横向缩放（cv::resize，纵向比例为1），
+// 再按cv::resize INTER_LINEAR的坐标映射在条带间做纵向线性插值。
+// 只保留尚未用完的横向结果行，内存与输出高度无关。
+class StreamingResizer {
+public:
+    static const int kOutputBatchRows = 64;
+
+    StreamingResizer(int srcRows, cv::Size dstSize, int channels, StripWriter& writer)
+        : srcRows_(srcRows), dstSize_(dstSize), channels_(channels), writer_(writer) {}
+
+    bool push(const cv::Mat& rows) {
+        cv::Mat scaled;
+        cv::resize(rows, scaled, cv::Size(dstSize_.width, rows.rows), 0, 0, cv::INTER_LINEAR);
+        append(scaled);
+        return emit();
+    }
+
+    size_t bufferBytes() const { return pending_.total() * pending_.elemSize() + out_.total() * out_.elemSize(); }
+
+private:
+    // 输出行dy对应的源行与权重，与cv::resize INTER_LINEAR一致
+    void sourceRow(int dy, int& sy, float& f) const {
+        double scale = static_cast<double>(srcRows_) / dstSize_.height;
+        double fy = (dy + 0.5) * scale - 0.5;
+        sy = static_cast<int>(std::floor(fy));
+        f = static_cast<float>(fy - sy);
+        if (sy < 0) {
+            sy = 0;
+            f = 0;
+        }
+        if (sy >= srcRows_ - 1) {
+            sy = srcRows_ - 1;
+            f = 0;
+        }
+    }
+
+    void append(const cv::Mat& rows) {
+        if (pending_.empty()) {
+            pending_ = rows;
+            return;
+        }
+        cv::Mat merged(pending_.rows + rows.rows, rows.cols, rows.type());
+        pending_.copyTo(merged.rowRange(0, pending_.rows));
+        rows.copyTo(merged.rowRange(pending_.rows, merged.rows));
+        pending_ = merged;
+    }
+
+    bool emit() {
+        const int available = pendingStart_ + pending_.rows;
+        const int rowSamples = dstSize_.width * channels_;
+        int count = 0;
+        if (out_.empty()) {
+            out_.create(std::min(kOutputBatchRows, dstSize_.height), dstSize_.width, CV_8UC(channels_));
+        }
+        while (nextDst_ < dstSize_.height) {
+            int sy;
+            float f;
+            sourceRow(nextDst_, sy, f);
+            int sy1 = std::min(sy + 1, srcRows_ - 1);
+            if (sy1 >= available) {
+                break;
+            }
+            if (count == out_.rows) {
+                if (!writer_.write(out_)) {
+                    return false;
+                }
+                count = 0;
+            }
+            const unsigned char* a = pending_.ptr<unsigned char>(sy - pendingStart_);
+            const unsigned char* b = pending_.ptr<unsigned char>(sy1 - pendingStart_);
+            unsigned char* dst = out_.ptr<unsigned char>(count);
+            for (int i = 0; i < rowSamples; ++i) {
+                dst[i] = cv::saturate_cast<unsigned char>(a[i] + (b[i] - a[i]) * f);
+            }
+            ++count;
+            ++nextDst_;
+        }
+        if (count > 0 && !writer_.write(out_.rowRange(0, count))) {
+            return false;
+        }
+
+        // 丢弃之后不再用到的源行
+        if (nextDst_ < dstSize_.height) {
+            int sy;
+            float f;
+            sourceRow(nextDst_, sy, f);
+            int drop = std::min(sy - pendingStart_, pending_.rows);
+            if (drop > 0) {
+                pending_ = pending_.rowRange(drop, pending_.rows).clone();
+                pendingStart_ += drop;
+            }
+        } else {
+            pending_.release();
+        }
+        return true;
+    }
+
+    int srcRows_;
+    cv::Size dstSize_;
+    int channels_;
+    StripWriter& writer_;
+    cv::Mat pending_;       // 横向缩放后的源行，第一行对应源图像的pendingStart_行
+    int pendingStart_ = 0;
+    int nextDst_ = 0;
+    cv::Mat out_;
+};
+
+} // namespace
+
+bool processImageStreaming(const std::string& input, const std::string& output,
+                           const PipelineParams& params, const StreamingOptions& options,
+                           StreamingStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    StreamingStats local;
+
+    std::unique_ptr<StripReader> reader = openStripReader(input);
+    if (!reader) {
+        std::cerr << "无法打开图像: " << input << std::endl;
+        return false;
+    }
+    const cv::Size size = reader->size();
+    const cv::Size outSize = params.resize ? cv::Size(params.resizeWidth, params.resizeHeight) : size;
+    // 输出通道数与applyFilterStages一致：灰度输入全程单通道，灰度阶段输出单通道，调色表把灰度输入展开为BGR
+    const int channels = reader->channels();
+    const int outChannels = params.grayscale ? 1 : (params.grading ? 3 : channels);
+
+    std::unique_ptr<StripWriter> writer = createStripWriter(output);
+    if (!writer->begin(output, outSize, outChannels)) {
+        std::cerr << "无法写入图像: " << output << std::endl;
+        return false;
+    }
+    local.bounded = reader->streaming() && writer->streaming();
+
+    // 按内存上限确定条带高度：读取窗口、处理副本及滤波临时缓冲各按一份计算，
+    // 启用resize时再加上横向缩放结果与输出行
+    const int halo = pipelineHaloRows(params);
+    const size_t rowBytes = static_cast<size_t>(size.width) * channels;
+    const size_t outRowBytes = static_cast<size_t>(outSize.width) * outChannels;
+    const size_t perRow = 3 * rowBytes + (params.resize ? 2 * outRowBytes : 0);
+    long long budgetRows = static_cast<long long>(options.memoryBudget / std::max<size_t>(perRow, 1)) - 2 * halo;
+    const int minRows = 16;
+    if (budgetRows < minRows) {
+        std::cerr << "内存上限过小，条带高度按" << minRows << "行处理" << std::endl;
+        budgetRows = minRows;
+    }
+    const int stripRows = static_cast<int>(std::min<long long>(budgetRows, size.height));
+    local.stripRows = stripRows;
+    local.haloRows = halo;
+
+    // 窗口缓冲区：上一条带末尾保留的halo行 + 本条带的行 + 下方halo行
+    cv::Mat window(std::min(size.height, stripRows + 2 * halo), size.width, CV_8UC(channels));
+    int windowStart = 0; // 窗口第一行对应的图像行
+    int windowRows = 0;
+    StreamingResizer resizer(size.height, outSize, outChannels, *writer);
+
+    for (int outStart = 0; outStart < size.height; outStart += stripRows) {
+        const int outEnd = std::min(size.height, outStart + stripRows);
+        const int needStart = std::max(0, outStart - halo);
+        const int needEnd = std::min(size.height, outEnd + halo);
+
+        // 把仍需要的halo行移到窗口顶部，再顺序读取新行
+        int keep = windowStart + windowRows - needStart;
+        if (keep > 0 && needStart > windowStart) {
+            std::memmove(window.ptr(0), window.ptr(needStart - windowStart), static_cast<size_t>(keep) * window.step);
+        }
+        windowStart = needStart;
+        windowRows = std::max(keep, 0);
+        cv::Mat fresh = window.rowRange(windowRows, needEnd - needStart);
+        if (!fresh.empty() && !reader->read(fresh)) {
+            std::cerr << "读取图像数据失败: " << input << std::endl;
+            return false;
+        }
+        windowRows = needEnd - needStart;
+
+        // 复制成独立的Mat再处理，使滤波在条带边界按整图边界方式取值；只保留离边界足够远的行
+        cv::Mat work = window.rowRange(0, windowRows).clone();
+        applyFilterStages(work, params);
+        cv::Mat valid = work.rowRange(outStart - needStart, outEnd - needStart);
+
+        bool ok = params.resize ? resizer.push(valid) : writer->write(valid);
+        if (!ok) {
+            std::cerr << "写入图像数据失败: " << output << std::endl;
+            return false;
+        }
+        ++local.strips;
+        size_t bytes = window.total() * window.elemSize() + 2 * work.total() * work.elemSize() + resizer.bufferBytes();
+        local.peakBytes = std::max(local.peakBytes, bytes);
+    }
+
+    if (!writer->finish()) {
+        std::cerr << "写入图像失败: " << output << std::endl;
+        return false;
+    }
+    local.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) {
+        *stats = local;
+    }
+    return true;
+}
@@ -0,0 +1,322 @@
+#include "strip_io.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <iostream>
+#include "image_utils.h"
+
+#ifdef IMAGE_UTILS_WITH_PNG
+#include <png.h>
+#endif
+
+namespace {
+
+// 不支持流式解码的格式：整幅读入后按条带提供
+class WholeImageReader : public StripReader {
+public:
+    bool open(const std::string& path) {
+        image_ = readImage(path);
+        channels_ = image_.channels();
+        return !image_.empty();
+    }
+    cv::Size size() const override { return image_.size(); }
+    int channels() const override { return channels_; }
+    bool read(cv::Mat& rows) override {
+        if (next_ + rows.rows > image_.rows) {
+            return false;
+        }
+        image_.rowRange(next_, next_ + rows.rows).copyTo(rows);
+        next_ += rows.rows;
+        if (next_ == image_.rows) {
+            image_.release();
+        }
+        return true;
+    }
+    bool streaming() const override { return false; }
+
+private:
+    cv::Mat image_;
+    int channels_ = 3;
+    int next_ = 0;
+};
+
+// 不支持流式编码的格式：收集所有条带后一次性写出
+class WholeImageWriter : public StripWriter {
+public:
+    bool begin(const std::string& path, cv::Size size, int channels) override {
+        path_ = path;
+        image_.create(size, CV_8UC(channels));
+        written_ = 0;
+        return true;
+    }
+    bool write(const cv::Mat& rows) override {
+        if (written_ + rows.rows > image_.rows) {
+            return false;
+        }
+        rows.copyTo(image_.rowRange(written_, written_ + rows.rows));
+        written_ += rows.rows;
+        return true;
+    }
+    bool finish() override {
+        bool ok = written_ == image_.rows && writeImage(path_, image_);
+        image_.release();
+        return ok;
+    }
+    bool streaming() const override { return false; }
+
+private:
+    std::string path_;
+    cv::Mat image_;
+    int written_ = 0;
+};
+
+#ifdef IMAGE_UTILS_WITH_PNG
+
+// libpng逐行解码，变换设置与cv::imread(IMREAD_ANYCOLOR)一致：16位截为8位，调色板/低位灰度展开，去掉alpha，
+// 灰度图输出单通道，其余输出BGR
+class PNGStripReader : public StripReader {
+public:
+    ~PNGStripReader() override {
+        if (png_) {
+            png_destroy_read_struct(&png_, &info_, nullptr);
+        }
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    bool open(const std::string& path) {
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_) {
+            return false;
+        }
+        png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        info_ = png_ ? png_create_info_struct(png_) : nullptr;
+        if (!info_) {
+            return false;
+        }
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        png_init_io(png_, file_);
+        png_read_info(png_, info_);
+
+        png_uint_32 width = 0, height = 0;
+        int bitDepth = 0, colorType = 0, interlace = 0;
+        png_get_IHDR(png_, info_, &width, &height, &bitDepth, &colorType, &interlace, nullptr, nullptr);
+        if (interlace != PNG_INTERLACE_NONE) {
+            return false; // 隔行扫描的PNG无法逐行输出，交给整幅解码
+        }
+        if (bitDepth == 16) {
+            png_set_strip_16(png_);
+        }
+        if (colorType == PNG_COLOR_TYPE_PALETTE) {
+            png_set_palette_to_rgb(png_);
+        }
+        if ((colorType & PNG_COLOR_MASK_COLOR) == 0 && bitDepth < 8) {
+            png_set_expand_gray_1_2_4_to_8(png_);
+        }
+        if (colorType & PNG_COLOR_MASK_ALPHA) {
+            png_set_strip_alpha(png_);
+        }
+        channels_ = colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA ? 1 : 3;
+        png_set_bgr(png_);
+        png_read_update_info(png_, info_);
+
+        size_ = cv::Size(static_cast<int>(width), static_cast<int>(height));
+        return png_get_rowbytes(png_, info_) == static_cast<size_t>(size_.width) * channels_;
+    }
+
+    cv::Size size() const override { return size_; }
+    int channels() const override { return channels_; }
+
+    bool read(cv::Mat& rows) override {
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        for (int y = 0; y < rows.rows; ++y) {
+            png_read_row(png_, rows.ptr<png_byte>(y), nullptr);
+        }
+        return true;
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    png_structp png_ = nullptr;
+    png_infop info_ = nullptr;
+    cv::Size size_;
+    int channels_ = 3;
+};
+
+class PNGStripWriter : public StripWriter {
+public:
+    ~PNGStripWriter() override {
+        if (png_) {
+            png_destroy_write_struct(&png_, &info_);
+        }
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    bool begin(const std::string& path, cv::Size size, int channels) override {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            return false;
+        }
+        png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        info_ = png_ ? png_create_info_struct(png_) : nullptr;
+        if (!info_) {
+            return false;
+        }
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        png_init_io(png_, file_);
+        // 与cv::imwrite的默认压缩级别相同
+        png_set_compression_level(png_, 1);
+        png_set_IHDR(png_, info_, size.width, size.height, 8, channels == 1 ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png_, info_);
+        png_set_bgr(png_);
+        return true;
+    }
+
+    bool write(const cv::Mat& rows) override {
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        for (int y = 0; y < rows.rows; ++y) {
+            png_write_row(png_, rows.ptr<png_byte>(y));
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        png_write_end(png_, nullptr);
+        png_destroy_write_struct(&png_, &info_);
+        png_ = nullptr;
+        bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    png_structp png_ = nullptr;
+    png_infop info_ = nullptr;
+};
+
+#endif // IMAGE_UTILS_WITH_PNG
+
+} // namespace
+
+bool PNMStripReader::open(const std::string& path) {
+    if (!file_.open(path) || !parsePNMHeader(file_.data(), file_.size(), header_)) {
+        file_.close();
+        return false;
+    }
+    pos_ = header_.dataOffset;
+    discarded_ = 0;
+    return true;
+}
+
+bool PNMStripReader::read(cv::Mat& rows) {
+    if (!decodePNMRows(file_.data(), file_.size(), header_, pos_, rows)) {
+        std::cerr << "PNM像素数据不完整" << std::endl;
+        return false;
+    }
+    // 已解码的部分不会再访问，释放对应的映射页，避免常驻内存随文件大小增长
+    discarded_ = file_.discard(discarded_, pos_ - discarded_);
+    return true;
+}
+
+bool PPMStripWriter::begin(const std::string& path, cv::Size size, int channels) {
+    if (channels != 1 && channels != 3) {
+        std::cerr << "PPM/PGM只支持单通道或三通道图像" << std::endl;
+        return false;
+    }
+    file_.open(path, std::ios::binary);
+    if (!file_) {
+        std::cerr << "无法写入PPM文件" << std::endl;
+        return false;
+    }
+    size_ = size;
+    channels_ = channels;
+    written_ = 0;
+    row_.resize(channels == 3 ? static_cast<size_t>(size.width) * 3 : 0);
+    file_ << (channels == 1 ? "P5\n" : "P6\n") << size.width << " " << size.height << "\n255\n";
+    return static_cast<bool>(file_);
+}
+
+bool PPMStripWriter::write(const cv::Mat& rows) {
+    if (rows.cols != size_.width || rows.type() != CV_8UC(channels_) || written_ + rows.rows > size_.height) {
+        return false;
+    }
+    if (channels_ == 1) {
+        // P5的样本顺序与内存相同，逐行直接写出
+        for (int y = 0; y < rows.rows; ++y) {
+            file_.write(reinterpret_cast<const char*>(rows.ptr<unsigned char>(y)), size_.width);
+        }
+        written_ += rows.rows;
+        return static_cast<bool>(file_);
+    }
+    // PPM格式的图像数据是RGB格式，逐行转换后写出
+    for (int y = 0; y < rows.rows; ++y) {
+        const unsigned char* src = rows.ptr<unsigned char>(y);
+        for (int x = 0; x < size_.width; ++x) {
+            row_[3 * x] = src[3 * x + 2];
+            row_[3 * x + 1] = src[3 * x + 1];
+            row_[3 * x + 2] = src[3 * x];
+        }
+        file_.write(reinterpret_cast<const char*>(row_.data()), static_cast<std::streamsize>(row_.size()));
+    }
+    written_ += rows.rows;
+    return static_cast<bool>(file_);
+}
+
+bool PPMStripWriter::finish() {
+    file_.close();
+    return written_ == size_.height && !file_.fail();
+}
+
+std::unique_ptr<StripReader> openStripReader(const std::string& path) {
+    std::string ext = lowerExtension(path);
+    if (ext == "ppm" || ext == "pgm" || ext == "pnm") {
+        auto reader = std::make_unique<PNMStripReader>();
+        if (reader->open(path)) {
+            return reader;
+        }
+        return nullptr;
+    }
+#ifdef IMAGE_UTILS_WITH_PNG
+    if (ext == "png") {
+        auto reader = std::make_unique<PNGStripReader>();
+        if (reader->open(path)) {
+            return reader;
+        }
+        // 隔行扫描等情况退回整幅解码
+    }
+#endif
+    auto reader = std::make_unique<WholeImageReader>();
+    if (reader->open(path)) {
+        return reader;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<StripWriter> createStripWriter(const std::string& path) {
+    std::string ext = lowerExtension(path);
+    if (ext == "ppm" || ext == "pgm" || ext == "pnm") {
+        return std::make_unique<PPMStripWriter>();
+    }
+#ifdef IMAGE_UTILS_WITH_PNG
+    if (ext == "png") {
+        return std::make_unique<PNGStripWriter>();
+    }
+#endif
+    return std::make_unique<WholeImageWriter>();
+}
@@ -0,0 +1,91 @@
+#include "tiled_pipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "trace.h"
+
+namespace {
+
+// 块的边长：含halo的一块在输入、模糊临时缓冲与输出中各出现一次，三份合计不超过tileBytes。
+// 取16的倍数使每行起点对齐；halo较大时块至少是halo的两倍，否则重复计算的比例过高
+int tileSide(size_t tileBytes, size_t elemSize, int halo) {
+    int side = static_cast<int>(std::sqrt(static_cast<double>(tileBytes) / (3.0 * elemSize)));
+    int inner = std::max({side - 2 * halo, 2 * halo, 32});
+    return std::max(16, inner / 16 * 16);
+}
+
+} // namespace
+
+cv::Mat applyPipelineTiled(const cv::Mat& image, const PipelineParams& params, const TileOptions& options, TileStats* stats) {
+    if (image.empty()) {
+        return cv::Mat();
+    }
+    auto start = std::chrono::steady_clock::now();
+    TRACE_SCOPE_IMAGE("pipeline-tiled", image);
+
+    WorkStealingPool& pool = options.pool ? *options.pool : sharedWorkStealingPool();
+    const int threads = std::min(options.threads > 0 ? options.threads : cv::getNumThreads(), pool.threadCount());
+    const int halo = pipelineHaloRows(params);
+    const int side = tileSide(options.tileBytes, image.elemSize(), halo);
+    const int tileCols = (image.cols + side - 1) / side;
+    const int tileRows = (image.rows + side - 1) / side;
+    const size_t tileCount = static_cast<size_t>(tileCols) * tileRows;
+
+    TileStats local;
+    local.tileWidth = std::min(side, image.cols);
+    local.tileHeight = std::min(side, image.rows);
+    local.halo = halo;
+    local.threads = threads;
+    local.tiles = static_cast<int>(tileCount);
+
+    cv::Mat result;
+    if (tileCount <= 1) {
+        // 整幅图像放得进一块，直接按整图处理
+        result = image.clone();
+        applyFilterStages(result, params);
+    } else {
+        // 输出通道数与applyFilterStages一致：灰度阶段输出单通道，调色表把灰度输入展开为BGR
+        const int channels = params.grayscale ? 1 : (params.grading && image.depth() == CV_8U ? 3 : image.channels());
+        result.create(image.size(), CV_MAKETYPE(image.depth(), channels));
+        const cv::Rect bounds(0, 0, image.cols, image.rows);
+        const uint64_t stealsBefore = pool.stats().steals;
+
+        // 块按行优先编号，线程池按连续区间分配，每个线程先处理相邻的块；
+        // 块内各阶段在当前线程上串行执行，不再各自fork/join
+        pool.run(tileCount, [&](size_t index) {
+            const int tx = static_cast<int>(index % tileCols);
+            const int ty = static_cast<int>(index / tileCols);
+            const cv::Rect inner = cv::Rect(tx * side, ty * side, side, side) & bounds;
+            const cv::Rect outer = cv::Rect(inner.x - halo, inner.y - halo, inner.width + 2 * halo, inner.height + 2 * halo) & bounds;
+
+            // 复制为独立的Mat，使图像边缘的滤波按整图边界取值；每个线程复用自己的块缓冲区
+            thread_local cv::Mat work;
+            image(outer).copyTo(work);
+            applyFilterStages(work, params, true);
+            work(cv::Rect(inner.x - outer.x, inner.y - outer.y, inner.width, inner.height)).copyTo(result(inner));
+        }, threads);
+        local.steals = pool.stats().steals - stealsBefore;
+    }
+    applyResizeStage(result, result, params.resize, params.resizeWidth, params.resizeHeight);
+
+    local.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) {
+        *stats = local;
+    }
+    return result;
+}
+
+cv::Mat applyPipelineRegion(const cv::Mat& image, const PipelineParams& params, const cv::Rect& region, const TileOptions& options) {
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    const cv::Rect inner = region & bounds;
+    if (inner.empty()) {
+        return cv::Mat();
+    }
+    TRACE_SCOPE("pipeline-region");
+    PipelineParams filters = params;
+    filters.resize = false;
+    const int halo = pipelineHaloRows(filters);
+    const cv::Rect outer = cv::Rect(inner.x - halo, inner.y - halo, inner.width + 2 * halo, inner.height + 2 * halo) & bounds;
+    cv::Mat rendered = applyPipelineTiled(image(outer), filters, options);
+    return rendered(cv::Rect(inner.x - outer.x, inner.y - outer.y, inner.width, inner.height));
+}
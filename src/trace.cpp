@@ -0,0 +1,148 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace trace_detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+const size_t kCapacity = 1 << 16; // 必须是2的幂
+
+// 每个槽位带一个序号：写入中为2n+1，写完为2n+2，读取方据此跳过未完成或已被覆盖的槽位
+struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    TraceEvent event;
+};
+
+std::unique_ptr<Slot[]> gSlots(new Slot[kCapacity]);
+std::atomic<uint64_t> gHead{0};
+const auto gEpoch = std::chrono::steady_clock::now();
+
+thread_local int64_t tAllocatedBytes = 0;
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gEpoch).count());
+}
+
+uint32_t currentThreadId() {
+    static std::atomic<uint32_t> nextId{1};
+    thread_local uint32_t id = nextId.fetch_add(1);
+    return id;
+}
+
+// 只统计字节数，实际分配交给默认分配器；返回的UMatData仍归默认分配器管理，
+// 因此卸载后释放已有的Mat也不受影响
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base_(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        if (!data) {
+            int64_t bytes = CV_ELEM_SIZE(type);
+            for (int i = 0; i < dims; ++i) {
+                bytes *= sizes[i];
+            }
+            tAllocatedBytes += bytes;
+        }
+        return base_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        return base_->allocate(data, flags, usageFlags);
+    }
+    void deallocate(cv::UMatData* data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator* base_;
+};
+
+bool readSlot(uint64_t index, TraceEvent& event) {
+    const Slot& slot = gSlots[index & (kCapacity - 1)];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != 2 * index + 2) {
+        return false;
+    }
+    event = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+} // namespace
+
+void setTraceEnabled(bool enabled) {
+    static CountingMatAllocator allocator(cv::Mat::getStdAllocator());
+    cv::Mat::setDefaultAllocator(enabled ? &allocator : nullptr);
+    trace_detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void traceRecord(const TraceEvent& event) {
+    uint64_t index = gHead.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = gSlots[index & (kCapacity - 1)];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<TraceEvent> traceEventsSince(uint64_t& cursor) {
+    uint64_t head = gHead.load(std::memory_order_acquire);
+    uint64_t first = std::max(cursor, head > kCapacity ? head - kCapacity : 0);
+    std::vector<TraceEvent> events;
+    events.reserve(static_cast<size_t>(head - std::min(first, head)));
+    for (uint64_t i = first; i < head; ++i) {
+        TraceEvent event;
+        if (readSlot(i, event)) {
+            events.push_back(event);
+        }
+    }
+    cursor = std::max(cursor, head);
+    return events;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    uint64_t cursor = 0;
+    std::vector<TraceEvent> events = traceEventsSince(cursor);
+
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "无法写入trace文件: " << path << std::endl;
+        return false;
+    }
+    // "X"为完整事件，时间单位为微秒
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& e = events[i];
+        file << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.threadId
+             << ", \"ts\": " << e.startNs / 1000.0 << ", \"dur\": " << e.durationNs / 1000.0
+             << ", \"args\": {\"width\": " << e.width << ", \"height\": " << e.height
+             << ", \"channels\": " << e.channels << ", \"alloc_bytes\": " << e.allocatedBytes << "}}"
+             << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    file << "]}\n";
+    return static_cast<bool>(file);
+}
+
+void TraceScope::begin() {
+    allocatedStart_ = tAllocatedBytes;
+    startNs_ = nowNs();
+}
+
+void TraceScope::end() {
+    TraceEvent event;
+    event.name = name_;
+    event.startNs = startNs_;
+    event.durationNs = nowNs() - startNs_;
+    event.threadId = currentThreadId();
+    event.width = width_;
+    event.height = height_;
+    event.channels = channels_;
+    event.allocatedBytes = tAllocatedBytes - allocatedStart_;
+    traceRecord(event);
+}
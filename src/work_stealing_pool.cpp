@@ -0,0 +1,152 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < threads; ++i) {
+        lanes_.emplace_back(new Lane());
+    }
+    // 第0个队列由调用run()的线程处理
+    for (int i = 1; i < threads; ++i) {
+        threads_.emplace_back(&WorkStealingPool::workerMain, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task, int workers) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> runLock(runMutex_);
+    const int lanes = static_cast<int>(std::min<size_t>(count, workers > 0 ? std::min(workers, threadCount()) : threadCount()));
+    ++runs_;
+    tasks_ += count;
+
+    // 按连续区间分配，每个线程先处理一段相邻的任务
+    for (int lane = 0; lane < lanes; ++lane) {
+        std::lock_guard<std::mutex> lock(lanes_[lane]->mutex);
+        for (size_t i = count * lane / lanes; i < count * (lane + 1) / lanes; ++i) {
+            lanes_[lane]->tasks.push_back(i);
+        }
+    }
+    remaining_.store(count, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        error_ = nullptr;
+        failed_.store(false, std::memory_order_relaxed);
+        activeLanes_ = lanes;
+        busyWorkers_ = lanes - 1;
+        ++generation_;
+    }
+    if (lanes > 1) {
+        wake_.notify_all();
+    }
+
+    drain(0);
+
+    // 任务全部完成且后台线程都已离开本批后才返回，task的引用不会被带到下一批
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return remaining_.load(std::memory_order_acquire) == 0 && busyWorkers_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error); // 本批已经完整结束，调用者看到的是第一个任务抛出的异常
+    }
+}
+
+WorkStealingPool::Stats WorkStealingPool::stats() const {
+    Stats stats;
+    stats.runs = runs_.load();
+    stats.tasks = tasks_.load();
+    stats.steals = steals_.load();
+    return stats;
+}
+
+void WorkStealingPool::workerMain(int lane) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            if (lane >= activeLanes_) {
+                continue; // 本批限制了线程数
+            }
+        }
+        drain(lane);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busyWorkers_;
+        }
+        done_.notify_all();
+    }
+}
+
+void WorkStealingPool::drain(int lane) {
+    size_t task;
+    while (takeTask(lane, task)) {
+        // 某个任务抛出异常后，剩余任务只取出计数而不再执行，本批照常结束后由run()重新抛出
+        if (!failed_.load(std::memory_order_relaxed)) {
+            try {
+                (*task_)(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::takeTask(int lane, size_t& task) {
+    {
+        Lane& own = *lanes_[lane];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // 从下一个线程开始依次尝试窃取，取对方队列末端（离对方正在处理的数据最远）
+    for (int offset = 1; offset < activeLanes_; ++offset) {
+        Lane& victim = *lanes_[(lane + offset) % activeLanes_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            ++steals_;
+            return true;
+        }
+    }
+    // 任务不会再生成新任务，所有队列都空了本批就不会再有任务可取
+    return false;
+}
+
+WorkStealingPool& sharedWorkStealingPool() {
+    static WorkStealingPool pool;
+    return pool;
+}